@@ -1,30 +1,60 @@
 from flask import Flask, request, jsonify
 import hashlib
 
+from share_cache import ShareCache
+
+# Batch SHA-256 from native/, if it has been built
+try:
+    import share_verify
+except OSError:
+    share_verify = None
+
 app = Flask(__name__)
 
 runtime_environments = ["env0", "env1", "env2", "env3", "env4", "env5", "env6", "env7", "env8", "env9"]
 
+# Shares verified recently, so that resubmissions are not hashed again
+verified_shares = ShareCache()
+
 @app.route('/verify', methods=['POST'])
 def verify_shares():
     data = request.get_json()
-    all_valid = True
-
-    for item in data['data_shares']:
+    items = data['data_shares']
+    valid = [False] * len(items)
+    cached = [False] * len(items)
+    misses = []
+    messages = []
+    signatures = []
+
+    for i, item in enumerate(items):
         share = item['share']
         signature = item['signature']
         user_id = item['user_id']
 
         rte = runtime_environments[user_id]
 
-        combined_data = f"{share}-{rte}"
-        hash_result = hashlib.sha256(combined_data.encode()).hexdigest()
+        if verified_shares.lookup(user_id, signature, share):
+            valid[i] = cached[i] = True
+            continue
+
+        misses.append(i)
+        messages.append(f"{share}-{rte}")
+        signatures.append(signature)
+
+    # Every share is checked, so the caller learns which ones failed
+    if share_verify is not None:
+        results = share_verify.verify(messages, signatures)
+    else:
+        results = [hashlib.sha256(combined_data.encode()).hexdigest() == signature
+                   for combined_data, signature in zip(messages, signatures)]
 
-        if hash_result != signature:
-            all_valid = False
-            break
+    for i, ok in zip(misses, results):
+        valid[i] = ok
+        if ok:
+            item = items[i]
+            verified_shares.add(item['user_id'], item['signature'], item['share'])
 
-    return jsonify({'status': all_valid})
+    return jsonify({'status': all(valid), 'valid': valid, 'cached': cached})
 
 if __name__ == '__main__':
     app.run(debug=True, port=8000)
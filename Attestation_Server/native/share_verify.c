@@ -0,0 +1,659 @@
+/*
+
+        share_verify.c -- batch SHA-256 for the share checks of the
+        Attestation Server
+
+        Each share is checked as sha256("<share>-<runtime environment>") =
+        signature.  The messages are short (a share line and a few bytes), so
+        a batch is many independent hashes of one to a few blocks, and the
+        cost is in the compression function.  Three versions of it:
+
+        * sha-ni: the x86 SHA extensions, two rounds per instruction, one
+          message at a time.
+        * avx2: eight messages side by side, one per 32-bit lane, with the
+          rounds in plain AVX2 arithmetic.  A lane that finishes its message
+          takes the next one, so messages of different lengths share the
+          registers without waiting for each other.
+        * generic: portable C, one message at a time.
+
+        The best one the CPU has is picked on first use.
+
+*/
+
+#include "share_verify.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define SHARE_VERIFY_X86
+  #include <cpuid.h>
+  #include <immintrin.h>
+#endif
+
+#ifdef TEST
+  #include <stdio.h>
+
+  #include "CuTest.h"
+#endif
+
+static const uint32_t round_constants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static const uint32_t initial_state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                          0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                          0x1f83d9ab, 0x5be0cd19};
+
+/* Blocks in the padded form of a `len` byte message */
+static size_t padded_blocks(size_t len) { return (len + 8) / 64 + 1; }
+
+/*
+        padded_block() -- block `index` of the padded form of `len` bytes at
+                `msg` (the message, 0x80, zeros, the length in bits)
+
+        Returns `msg` itself for blocks wholly inside the message, and
+        otherwise builds the block in `scratch` (64 bytes).
+*/
+
+static const unsigned char *padded_block(const unsigned char *msg, size_t len,
+                                         size_t index, unsigned char *scratch) {
+  size_t start = index * 64;
+  int i;
+
+  if (start + 64 <= len) {
+    return msg + start;
+  }
+
+  size_t present = start < len ? len - start : 0;
+
+  memcpy(scratch, msg + start, present);
+  memset(scratch + present, 0, 64 - present);
+
+  if (start <= len) {
+    scratch[len - start] = 0x80;
+  }
+
+  if (index == padded_blocks(len) - 1) {
+    uint64_t bits = (uint64_t)len * 8;
+
+    for (i = 0; i < 8; ++i) {
+      scratch[56 + i] = (unsigned char)(bits >> (56 - 8 * i));
+    }
+  }
+
+  return scratch;
+}
+
+static void store_digest(const uint32_t *state, unsigned char *digest) {
+  int i;
+
+  for (i = 0; i < 8; ++i) {
+    digest[4 * i] = (unsigned char)(state[i] >> 24);
+    digest[4 * i + 1] = (unsigned char)(state[i] >> 16);
+    digest[4 * i + 2] = (unsigned char)(state[i] >> 8);
+    digest[4 * i + 3] = (unsigned char)state[i];
+  }
+}
+
+/* `count` consecutive blocks into `state`, for the backends that hash a message at a time */
+typedef void (*compress_fn)(uint32_t *state, const unsigned char *blocks, size_t count);
+
+/* The whole blocks of each message straight from `data`, then the padded tail */
+static void digests_serial(compress_fn compress, const unsigned char *data,
+                           const size_t *offsets, size_t count,
+                           unsigned char *digests) {
+  unsigned char scratch[64];
+  size_t i;
+
+  for (i = 0; i < count; ++i) {
+    const unsigned char *msg = data + offsets[i];
+    size_t len = offsets[i + 1] - offsets[i];
+    size_t blocks = padded_blocks(len);
+    uint32_t state[8];
+    size_t b;
+
+    memcpy(state, initial_state, sizeof(state));
+    compress(state, msg, len / 64);
+
+    for (b = len / 64; b < blocks; ++b) {
+      compress(state, padded_block(msg, len, b, scratch), 1);
+    }
+
+    store_digest(state, digests + i * SHARE_VERIFY_DIGEST_SIZE);
+  }
+}
+
+/*
+        Generic
+*/
+
+static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+static void compress_generic_block(uint32_t *state, const unsigned char *block) {
+  uint32_t w[64];
+  int i;
+
+  for (i = 0; i < 16; ++i) {
+    w[i] = ((uint32_t)block[4 * i] << 24) | ((uint32_t)block[4 * i + 1] << 16) |
+           ((uint32_t)block[4 * i + 2] << 8) | block[4 * i + 3];
+  }
+
+  for (i = 16; i < 64; ++i) {
+    w[i] = w[i - 16] + (rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3)) +
+           w[i - 7] + (rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10));
+  }
+
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+  uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+  for (i = 0; i < 64; ++i) {
+    uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) +
+                  ((e & f) ^ (~e & g)) + round_constants[i] + w[i];
+    uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) +
+                  ((a & b) ^ (a & c) ^ (b & c));
+
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+  state[5] += f;
+  state[6] += g;
+  state[7] += h;
+}
+
+static void compress_generic(uint32_t *state, const unsigned char *blocks,
+                             size_t count) {
+  size_t i;
+
+  for (i = 0; i < count; ++i) {
+    compress_generic_block(state, blocks + 64 * i);
+  }
+}
+
+static void digests_generic(const unsigned char *data, const size_t *offsets,
+                            size_t count, unsigned char *digests) {
+  digests_serial(compress_generic, data, offsets, count, digests);
+}
+
+#ifdef SHARE_VERIFY_X86
+/*
+        SHA-NI
+
+        The state is kept as ABEF and CDGH, the order sha256rnds2 takes it in,
+        and each sha256rnds2 does two rounds.  Message words 16 - 63 come four
+        at a time: W[4j + 16 ...] = msg2(msg1(X_j, X_j+1) + X_j+2..3 shifted by
+        one word, X_j+3), X_j being words 4j - 4j + 3.
+*/
+
+/* Load the state as ABEF and CDGH */
+__attribute__((target("sha,sse4.1")))
+static inline void sha_ni_load(const uint32_t *state, __m128i *abef, __m128i *cdgh) {
+  __m128i cdab = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)state), 0xB1);
+  __m128i efgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(state + 4)), 0x1B);
+
+  *abef = _mm_alignr_epi8(cdab, efgh, 8);
+  *cdgh = _mm_blend_epi16(efgh, cdab, 0xF0);
+}
+
+__attribute__((target("sha,sse4.1")))
+static inline void sha_ni_store(uint32_t *state, __m128i abef, __m128i cdgh) {
+  __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+  __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+
+  _mm_storeu_si128((__m128i *)state, _mm_blend_epi16(feba, dchg, 0xF0));
+  _mm_storeu_si128((__m128i *)(state + 4), _mm_alignr_epi8(dchg, feba, 8));
+}
+
+/* Message words 4g - 4g + 3 plus their round constants; x holds the last four groups */
+__attribute__((target("sha,sse4.1")))
+static inline __m128i sha_ni_words(__m128i *x, const unsigned char *block, int g) {
+  const __m128i byte_swap =
+      _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+  if (g < 4) {
+    x[g] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(block + 16 * g)),
+                            byte_swap);
+  } else {
+    __m128i sum = _mm_add_epi32(_mm_sha256msg1_epu32(x[g & 3], x[(g + 1) & 3]),
+                                _mm_alignr_epi8(x[(g + 3) & 3], x[(g + 2) & 3], 4));
+
+    x[g & 3] = _mm_sha256msg2_epu32(sum, x[(g + 3) & 3]);
+  }
+
+  return _mm_add_epi32(x[g & 3],
+                       _mm_loadu_si128((const __m128i *)(round_constants + 4 * g)));
+}
+
+__attribute__((target("sha,sse4.1")))
+static void compress_sha_ni(uint32_t *state, const unsigned char *blocks,
+                            size_t count) {
+  __m128i abef, cdgh, x[4];
+  size_t i;
+  int g;
+
+  if (count == 0) {
+    return;
+  }
+
+  sha_ni_load(state, &abef, &cdgh);
+
+  for (i = 0; i < count; ++i) {
+    const unsigned char *block = blocks + 64 * i;
+    __m128i abef_start = abef;
+    __m128i cdgh_start = cdgh;
+
+    /* Unrolled, so x[] stays in registers */
+#pragma GCC unroll 16
+    for (g = 0; g < 16; ++g) {
+      __m128i words = sha_ni_words(x, block, g);
+
+      cdgh = _mm_sha256rnds2_epu32(cdgh, abef, words);
+      abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(words, 0x0E));
+    }
+
+    abef = _mm_add_epi32(abef, abef_start);
+    cdgh = _mm_add_epi32(cdgh, cdgh_start);
+  }
+
+  sha_ni_store(state, abef, cdgh);
+}
+
+static void digests_sha_ni(const unsigned char *data, const size_t *offsets,
+                           size_t count, unsigned char *digests) {
+  digests_serial(compress_sha_ni, data, offsets, count, digests);
+}
+
+/*
+        AVX2, eight messages at a time
+
+        Lane l of every vector belongs to the message in lane l.  Each step
+        gathers the next block of every busy lane into words[i][l], runs the
+        64 rounds on all eight, and adds the result to that lane's state.
+        Idle lanes (at the end of the batch) hash zeros that are thrown away.
+*/
+
+#define LANES 8
+
+struct lane {
+  const unsigned char *msg;
+  size_t len;
+  size_t index;      // Message number in the batch
+  size_t block;      // Next block to hash
+  size_t blocks;     // Blocks in the padded message (0: idle lane)
+};
+
+__attribute__((target("avx2")))
+static inline __m256i rotr_x8(__m256i x, int n) {
+  return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+}
+
+__attribute__((target("avx2")))
+static void compress_x8(uint32_t state[8][LANES], uint32_t words[16][LANES]) {
+  __m256i w[16];
+  __m256i s[8];
+  __m256i start[8];
+  int i;
+
+  for (i = 0; i < 8; ++i) {
+    s[i] = start[i] = _mm256_loadu_si256((const __m256i *)state[i]);
+  }
+
+  for (i = 0; i < 16; ++i) {
+    w[i] = _mm256_loadu_si256((const __m256i *)words[i]);
+  }
+
+  /* Unrolled, so w[] stays in registers */
+#pragma GCC unroll 64
+  for (i = 0; i < 64; ++i) {
+    __m256i word;
+
+    if (i < 16) {
+      word = w[i];
+    } else {
+      __m256i w15 = w[(i - 15) & 15];
+      __m256i w2 = w[(i - 2) & 15];
+      __m256i sigma0 = _mm256_xor_si256(_mm256_xor_si256(rotr_x8(w15, 7), rotr_x8(w15, 18)),
+                                        _mm256_srli_epi32(w15, 3));
+      __m256i sigma1 = _mm256_xor_si256(_mm256_xor_si256(rotr_x8(w2, 17), rotr_x8(w2, 19)),
+                                        _mm256_srli_epi32(w2, 10));
+
+      word = _mm256_add_epi32(_mm256_add_epi32(w[i & 15], sigma0),
+                              _mm256_add_epi32(w[(i - 7) & 15], sigma1));
+      w[i & 15] = word;
+    }
+
+    __m256i e = s[4];
+    __m256i a = s[0];
+    __m256i big_sigma1 = _mm256_xor_si256(_mm256_xor_si256(rotr_x8(e, 6), rotr_x8(e, 11)),
+                                          rotr_x8(e, 25));
+    __m256i choose = _mm256_xor_si256(_mm256_and_si256(e, s[5]),
+                                      _mm256_andnot_si256(e, s[6]));
+    __m256i t1 = _mm256_add_epi32(
+        _mm256_add_epi32(_mm256_add_epi32(s[7], big_sigma1), choose),
+        _mm256_add_epi32(_mm256_set1_epi32((int)round_constants[i]), word));
+    __m256i big_sigma0 = _mm256_xor_si256(_mm256_xor_si256(rotr_x8(a, 2), rotr_x8(a, 13)),
+                                          rotr_x8(a, 22));
+    __m256i majority = _mm256_xor_si256(
+        _mm256_and_si256(a, s[1]),
+        _mm256_and_si256(_mm256_xor_si256(a, s[1]), s[2]));
+    __m256i t2 = _mm256_add_epi32(big_sigma0, majority);
+
+    s[7] = s[6];
+    s[6] = s[5];
+    s[5] = s[4];
+    s[4] = _mm256_add_epi32(s[3], t1);
+    s[3] = s[2];
+    s[2] = s[1];
+    s[1] = s[0];
+    s[0] = _mm256_add_epi32(t1, t2);
+  }
+
+  for (i = 0; i < 8; ++i) {
+    _mm256_storeu_si256((__m256i *)state[i], _mm256_add_epi32(s[i], start[i]));
+  }
+}
+
+/* Start message `index` in lane `l`, or leave the lane idle past the end */
+static void lane_start(struct lane *lane, uint32_t state[8][LANES], int l,
+                       const unsigned char *data, const size_t *offsets,
+                       size_t index, size_t count) {
+  int i;
+
+  lane->blocks = 0;
+
+  if (index >= count) {
+    return;
+  }
+
+  lane->msg = data + offsets[index];
+  lane->len = offsets[index + 1] - offsets[index];
+  lane->index = index;
+  lane->block = 0;
+  lane->blocks = padded_blocks(lane->len);
+
+  for (i = 0; i < 8; ++i) {
+    state[i][l] = initial_state[i];
+  }
+}
+
+static void digests_avx2(const unsigned char *data, const size_t *offsets,
+                         size_t count, unsigned char *digests) {
+  struct lane lanes[LANES];
+  uint32_t state[8][LANES];
+  uint32_t words[16][LANES];
+  unsigned char scratch[64];
+  size_t next = 0;
+  int busy;
+  int l;
+  int i;
+
+  for (l = 0; l < LANES; ++l) {
+    lane_start(&lanes[l], state, l, data, offsets, next++, count);
+  }
+
+  do {
+    busy = 0;
+
+    for (l = 0; l < LANES; ++l) {
+      struct lane *lane = &lanes[l];
+
+      if (lane->blocks == 0) {
+        for (i = 0; i < 16; ++i) {
+          words[i][l] = 0;
+        }
+
+        continue;
+      }
+
+      const unsigned char *block =
+          padded_block(lane->msg, lane->len, lane->block, scratch);
+
+      for (i = 0; i < 16; ++i) {
+        words[i][l] = ((uint32_t)block[4 * i] << 24) |
+                      ((uint32_t)block[4 * i + 1] << 16) |
+                      ((uint32_t)block[4 * i + 2] << 8) | block[4 * i + 3];
+      }
+
+      ++busy;
+    }
+
+    if (busy == 0) {
+      break;
+    }
+
+    compress_x8(state, words);
+
+    for (l = 0; l < LANES; ++l) {
+      struct lane *lane = &lanes[l];
+
+      if ((lane->blocks == 0) || (++lane->block < lane->blocks)) {
+        continue;
+      }
+
+      uint32_t lane_state[8];
+
+      for (i = 0; i < 8; ++i) {
+        lane_state[i] = state[i][l];
+      }
+
+      store_digest(lane_state, digests + lane->index * SHARE_VERIFY_DIGEST_SIZE);
+      lane_start(lane, state, l, data, offsets, next++, count);
+    }
+  } while (1);
+}
+
+static int cpu_has(const char *feature) {
+  unsigned int a, b, c, d;
+
+  if (!__get_cpuid(1, &a, &b, &c, &d)) {
+    return 0;
+  }
+
+  int sse41 = (c >> 19) & 1;
+  int ssse3 = (c >> 9) & 1;
+  /* AVX2 also needs the OS to save the YMM registers */
+  int ymm = ((c >> 27) & 1) && ((c >> 28) & 1);
+
+  if (ymm) {
+    unsigned int lo, hi;
+
+    __asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    ymm = (lo & 6) == 6;
+  }
+
+  if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+    return 0;
+  }
+
+  if (strcmp(feature, "sha-ni") == 0) {
+    return ((b >> 29) & 1) && sse41 && ssse3;
+  }
+
+  if (strcmp(feature, "avx2") == 0) {
+    return ((b >> 5) & 1) && ymm;
+  }
+
+  return 0;
+}
+#endif
+
+/*
+        Backend selection
+*/
+
+typedef void (*digests_fn)(const unsigned char *data, const size_t *offsets,
+                           size_t count, unsigned char *digests);
+
+struct backend {
+  const char *name;
+  digests_fn digests;
+};
+
+/* Best first */
+static const struct backend backends[] = {
+#ifdef SHARE_VERIFY_X86
+    {"sha-ni", digests_sha_ni},
+    {"avx2", digests_avx2},
+#endif
+    {"generic", digests_generic},
+};
+
+#define BACKEND_COUNT (sizeof(backends) / sizeof(backends[0]))
+
+static const struct backend *current = NULL;
+
+static int backend_available(const struct backend *backend) {
+#ifdef SHARE_VERIFY_X86
+  if (backend->digests != digests_generic) {
+    return cpu_has(backend->name);
+  }
+#endif
+  return 1;
+}
+
+int share_verify_set_backend(const char *name) {
+  size_t i;
+
+  for (i = 0; i < BACKEND_COUNT; ++i) {
+    if (((name == NULL) || (strcmp(name, backends[i].name) == 0)) &&
+        backend_available(&backends[i])) {
+      current = &backends[i];
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+static const struct backend *backend(void) {
+  if (current == NULL) {
+    share_verify_set_backend(NULL);
+  }
+
+  return current;
+}
+
+const char *share_verify_backend(void) { return backend()->name; }
+
+void share_verify_digests(const unsigned char *data, const size_t *offsets,
+                          size_t count, unsigned char *digests) {
+  backend()->digests(data, offsets, count, digests);
+}
+
+/* Messages hashed per pass of share_verify_batch(), whose digests sit on the stack */
+#define BATCH_SLICE 64
+
+size_t share_verify_batch(const unsigned char *data, const size_t *offsets,
+                          size_t count, const unsigned char *expected,
+                          unsigned char *bitmap) {
+  unsigned char digests[BATCH_SLICE * SHARE_VERIFY_DIGEST_SIZE];
+  const struct backend *hash = backend();
+  size_t valid = 0;
+  size_t start;
+  size_t i;
+
+  memset(bitmap, 0, (count + 7) / 8);
+
+  for (start = 0; start < count; start += BATCH_SLICE) {
+    size_t slice = count - start < BATCH_SLICE ? count - start : BATCH_SLICE;
+
+    hash->digests(data, offsets + start, slice, digests);
+
+    for (i = 0; i < slice; ++i) {
+      size_t k = start + i;
+
+      if (memcmp(digests + i * SHARE_VERIFY_DIGEST_SIZE,
+                 expected + k * SHARE_VERIFY_DIGEST_SIZE,
+                 SHARE_VERIFY_DIGEST_SIZE) == 0) {
+        bitmap[k / 8] |= (unsigned char)(1 << (k % 8));
+        ++valid;
+      }
+    }
+  }
+
+  return valid;
+}
+
+#ifdef TEST
+void Test_share_verify(CuTest *tc) {
+  /* "abc", "" and the 56 byte message whose length needs a block of its own */
+  static const unsigned char data[] =
+      "abcabcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+  static const unsigned char known[3][SHARE_VERIFY_DIGEST_SIZE] = {
+      {0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40,
+       0xde, 0x5d, 0xae, 0x22, 0x23, 0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17,
+       0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad},
+      {0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14, 0x9a, 0xfb, 0xf4,
+       0xc8, 0x99, 0x6f, 0xb9, 0x24, 0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b,
+       0x93, 0x4c, 0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55},
+      {0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26,
+       0x93, 0x0c, 0x3e, 0x60, 0x39, 0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff,
+       0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1}};
+  size_t offsets[4] = {0, 3, 3, 59};
+  unsigned char expected[3 * SHARE_VERIFY_DIGEST_SIZE];
+  unsigned char bitmap[1];
+  size_t i;
+
+  /* Messages of 0 - 299 bytes, for every backend against the generic one */
+  static unsigned char text[300 * 150];
+  static size_t lengths[301];
+  static unsigned char reference[300 * SHARE_VERIFY_DIGEST_SIZE];
+  static unsigned char digests[300 * SHARE_VERIFY_DIGEST_SIZE];
+
+  for (i = 0; i < sizeof(text); ++i) {
+    text[i] = (unsigned char)(i * 7 + (i >> 8));
+  }
+
+  for (i = 0; i <= 300; ++i) {
+    lengths[i] = i * (i - 1) / 2;
+  }
+
+  memcpy(expected, known, sizeof(expected));
+
+  CuAssertTrue(tc, share_verify_set_backend("generic"));
+  share_verify_digests(text, lengths, 300, reference);
+
+  for (i = 0; i < sizeof(backends) / sizeof(backends[0]); ++i) {
+    if (!share_verify_set_backend(backends[i].name)) {
+      printf("  %s: not on this CPU\n", backends[i].name);
+      continue;
+    }
+
+    CuAssertIntEquals(tc, 3, (int)share_verify_batch(data, offsets, 3, expected, bitmap));
+    CuAssertIntEquals(tc, 0x7, bitmap[0]);
+
+    share_verify_digests(text, lengths, 300, digests);
+    CuAssertIntEquals(tc, 0, memcmp(reference, digests, sizeof(digests)));
+
+    /* A wrong signature clears only its own bit */
+    expected[SHARE_VERIFY_DIGEST_SIZE] ^= 1;
+    CuAssertIntEquals(tc, 2, (int)share_verify_batch(data, offsets, 3, expected, bitmap));
+    CuAssertIntEquals(tc, 0x5, bitmap[0]);
+    expected[SHARE_VERIFY_DIGEST_SIZE] ^= 1;
+  }
+
+  CuAssertTrue(tc, share_verify_set_backend(NULL));
+  CuAssertIntEquals(tc, 0, share_verify_set_backend("none"));
+}
+#endif
@@ -0,0 +1,36 @@
+#ifndef SHARE_VERIFY_H
+#define SHARE_VERIFY_H
+
+#include <stddef.h>
+
+/**
+
+@file
+
+@brief Batch SHA-256 for the Attestation Server's share checks.
+
+A batch is `count` messages laid end to end in one buffer: message i is bytes
+[`offsets[i]`, `offsets[i + 1]`) of `data`, so `offsets` has `count + 1`
+entries.  The messages are hashed several at a time, with the SHA extensions
+(SHA-NI) where the CPU has them and eight to an AVX2 register otherwise.
+
+*/
+
+/// Size of a SHA-256 digest.
+#define SHARE_VERIFY_DIGEST_SIZE 32
+
+/// SHA-256 code in use: "sha-ni", "avx2" or "generic".
+const char * share_verify_backend(void);
+
+/// Use the backend called `name` (NULL: the best one the CPU has).  Returns 0 if the CPU lacks it.
+int share_verify_set_backend(const char * name);
+
+/// SHA-256 of each of the `count` messages, 32 bytes apiece into `digests`.
+void share_verify_digests(const unsigned char * data, const size_t * offsets, size_t count, unsigned char * digests);
+
+/// Hash the `count` messages and compare each with its 32 byte digest in `expected`.  Bit i % 8 of
+/// `bitmap[i / 8]` is set if message i matches, cleared if not.  Returns the number that match.
+size_t share_verify_batch(const unsigned char * data, const size_t * offsets, size_t count,
+                          const unsigned char * expected, unsigned char * bitmap);
+
+#endif
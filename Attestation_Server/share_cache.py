@@ -0,0 +1,59 @@
+"""Shares the Attestation Server has already verified, so retries are cheap.
+
+An entry is keyed by (user_id, signature), the signature being the SHA-256
+the share was checked against, and keeps the share itself: a later request
+is a hit only if it sends the same share, which a string compare settles
+far faster than hashing it again.  Only shares that matched are kept.  The
+cache is an LRU bounded both in entries and in the bytes of the shares it
+holds, and an entry older than the TTL is a miss.
+"""
+import collections
+import threading
+import time
+
+
+class ShareCache:
+    def __init__(self, max_entries=100000, max_bytes=256 << 20, ttl=600.0):
+        self.max_entries = max_entries
+        self.max_bytes = max_bytes
+        self.ttl = ttl
+        self._entries = collections.OrderedDict()  # (user_id, signature) -> (share, expiry)
+        self._bytes = 0
+        self._lock = threading.Lock()
+
+    def lookup(self, user_id, signature, share):
+        """True if this share was verified against this signature within the TTL."""
+        if not isinstance(signature, str):
+            return False
+        key = (user_id, signature)
+        with self._lock:
+            entry = self._entries.get(key)
+            if entry is None:
+                return False
+            if entry[1] <= time.monotonic():
+                self._remove(key)
+                return False
+            if entry[0] != share:
+                return False
+            self._entries.move_to_end(key)
+            return True
+
+    def add(self, user_id, signature, share):
+        """Remember that the share matched the signature."""
+        if not isinstance(signature, str) or not isinstance(share, str) or len(share) > self.max_bytes:
+            return
+        key = (user_id, signature)
+        with self._lock:
+            if key in self._entries:
+                self._remove(key)
+            self._entries[key] = (share, time.monotonic() + self.ttl)
+            self._bytes += len(share)
+            while len(self._entries) > self.max_entries or self._bytes > self.max_bytes:
+                self._remove(next(iter(self._entries)))
+
+    def __len__(self):
+        return len(self._entries)
+
+    def _remove(self, key):
+        share, _ = self._entries.pop(key)
+        self._bytes -= len(share)
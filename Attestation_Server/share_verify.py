@@ -0,0 +1,99 @@
+"""ctypes binding for native/share_verify, which checks share signatures in batches.
+
+Build the shared library with CMake (see native/CMakeLists.txt) and point
+SHARE_VERIFY_LIBRARY at it, or install it where the loader can find it.
+"""
+import array
+import ctypes
+import ctypes.util
+import itertools
+import os
+
+DIGEST_SIZE = 32
+
+# Messages per library call
+SLICE = 256
+
+# array type code of size_t, for the offsets
+_SIZE_T = next(code for code in 'LQI' if array.array(code).itemsize == ctypes.sizeof(ctypes.c_size_t))
+
+
+def _load():
+    path = os.environ.get('SHARE_VERIFY_LIBRARY') or ctypes.util.find_library('share_verify')
+    if path is None:
+        raise OSError('libshare_verify not found, set SHARE_VERIFY_LIBRARY')
+
+    lib = ctypes.CDLL(path)
+
+    lib.share_verify_backend.argtypes = []
+    lib.share_verify_backend.restype = ctypes.c_char_p
+    lib.share_verify_batch.argtypes = [ctypes.c_char_p, ctypes.POINTER(ctypes.c_size_t),
+                                       ctypes.c_size_t, ctypes.c_char_p, ctypes.c_char_p]
+    lib.share_verify_batch.restype = ctypes.c_size_t
+    return lib
+
+
+_lib = _load()
+
+
+def backend():
+    """Name of the SHA-256 code in use ('sha-ni', 'avx2' or 'generic')."""
+    return _lib.share_verify_backend().decode('ascii')
+
+
+def _expected(signature):
+    # hexdigest() is lower case, and the check has always been a string compare
+    if not isinstance(signature, str) or len(signature) != 2 * DIGEST_SIZE or signature != signature.lower():
+        return None
+    try:
+        return bytes.fromhex(signature)
+    except ValueError:
+        return None
+
+
+def _verify_slice(messages, signatures):
+    count = len(messages)
+
+    # Usually every signature is well formed and one fromhex() does them all
+    known = None
+    try:
+        joined = ''.join(signatures)
+        if joined != joined.lower() or set(map(len, signatures)) != {2 * DIGEST_SIZE}:
+            raise ValueError
+        expected = bytes.fromhex(joined)
+    except (TypeError, ValueError):
+        known = [_expected(signature) for signature in signatures]
+        expected = b''.join(e or bytes(DIGEST_SIZE) for e in known)
+
+    # str lengths are byte lengths only if the text is ASCII
+    try:
+        data = ''.join(messages).encode('ascii')
+    except (TypeError, UnicodeEncodeError):
+        messages = [m.encode() if isinstance(m, str) else m for m in messages]
+        data = b''.join(messages)
+
+    offsets = array.array(_SIZE_T, itertools.accumulate(map(len, messages), initial=0))
+    bitmap = ctypes.create_string_buffer((count + 7) // 8)
+
+    _lib.share_verify_batch(data, (ctypes.c_size_t * (count + 1)).from_buffer(offsets), count, expected, bitmap)
+
+    # Bit i of the bitmap, read as a little-endian integer, is message i
+    bits = format(int.from_bytes(bitmap.raw, 'little'), '0%db' % (8 * len(bitmap.raw)))
+    valid = [bit == '1' for bit in bits[:-count - 1:-1]]
+
+    if known is not None:
+        valid = [ok and e is not None for ok, e in zip(valid, known)]
+    return valid
+
+
+def verify(messages, signatures):
+    """Check sha256(messages[i]).hexdigest() == signatures[i] for every i.
+
+    `messages` are bytes, or str to be UTF-8 encoded.  Returns a list of
+    booleans, one per message.  The messages go to the library SLICE at a
+    time, so the copy that lays them end to end stays small and in cache.
+    """
+    valid = []
+    for start in range(0, len(messages), SLICE):
+        valid += _verify_slice(messages[start:start + SLICE], signatures[start:start + SLICE])
+    return valid
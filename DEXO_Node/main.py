@@ -5,7 +5,14 @@ def main():
     host = 'localhost'
     port =   10001
     node_id = 0
-    server = Server(host, port, node_id)
+    # The dealer's published share commitment (or the copy recorded with the contract), if any;
+    # without it every share is checked by the Attestation Server
+    commitment_file = None
+    commitment = None
+    if commitment_file is not None:
+        with open(commitment_file) as f:
+            commitment = f.read().strip()
+    server = Server(host, port, node_id, commitment)
     asyncio.run(server.run_server())
 
 if __name__ == "__main__":
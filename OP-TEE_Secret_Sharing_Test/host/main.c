@@ -25,11 +25,16 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#define _GNU_SOURCE /* sched_setaffinity() */
+
 #include <err.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 
 /* OP-TEE TEE client API (built by optee_client) */
 #include <tee_client_api.h>
@@ -37,537 +42,954 @@
 /* For the UUID (found in local file(s)) */
 #include <ss_test_ta.h>
 
-int call_ta(uint32_t cmd) {
-  TEEC_Result res = TEEC_ERROR_GENERIC;
-  TEEC_Context ctx = {};
-  TEEC_Session sess = {};
+/* Number of shares used for every benchmark configuration */
+static const uint32_t share_counts[] = {5, 10, 20, 30, 40, 50};
+
+/* Threshold as a function of the number of shares */
+struct threshold_rule {
+  const char *name;
+  uint32_t (*threshold)(uint32_t n);
+};
+
+static uint32_t two_thirds(uint32_t n) { return (n * 2 + 2) / 3; }
+
+static uint32_t half(uint32_t n) { return (n + 1) / 2; }
+
+static const struct threshold_rule threshold_rules[] = {
+    {"2n/3", two_thirds},
+    {"n/2", half},
+};
+
+/* Chunk size for the chunked split protocol (0 = split in one invoke) */
+static uint32_t chunk_size = 0;
+
+/* Splits per configuration in batch mode (0 = batch mode off) */
+static uint32_t batch_repeat = 0;
+
+/* Untimed runs before, and timed runs of, every configuration */
+static uint32_t warmup_runs = 2;
+static uint32_t timed_runs = 10;
+
+/* Largest number of concurrent sessions in thread mode (0 = mode off) */
+static uint32_t max_threads = 0;
+
+/* CPU to pin to, or in thread mode the first worker's CPU (-1 = no pinning) */
+static int pin_base = -1;
+
+/* Read the TA's per-phase profile of the last timed run */
+static int profile_phases = 0;
+
+/* Where one TA command spent its time, from TA_SS_TEST_CMD_PROFILE */
+struct ta_profile {
+  uint32_t random_us;
+  uint32_t evaluate_us;
+  uint32_t encode_us;
+  uint32_t alloc_us;
+  uint32_t heap_max;
+  uint32_t heap_size;
+  uint32_t lib_allocs;
+  uint32_t lib_peak;
+};
+
+/* How results are printed */
+enum output_format { OUTPUT_TEXT, OUTPUT_CSV, OUTPUT_JSON };
+static enum output_format output_format = OUTPUT_TEXT;
+
+/* One entry of the table of configurations to benchmark */
+struct bench_config {
+  uint32_t n;
+  uint32_t t;
+  const char *rule;
+};
+
+/* Summary of the timed runs of one measurement, in ms */
+struct bench_stats {
+  double min;
+  double median;
+  double p99;
+};
+
+/* Wall-clock time in ms, so time spent in the secure world is counted */
+static double now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/* Open a context and a session to the "ss_test" TA */
+static void open_ta(TEEC_Context *ctx, TEEC_Session *sess) {
+  TEEC_Result res;
   TEEC_UUID uuid = TA_SS_TEST_UUID;
   uint32_t err_origin = 0;
-  TEEC_Operation op = {};
-  // Public key exponent in big endian order
-  uint32_t data = 0;
-  // Modulus in big endian order
-  uint32_t data_signature = 0;
-  uint32_t RT_signature = 0;
-
-  /* Initialize a context connecting us to the TEE */
-  res = TEEC_InitializeContext(NULL, &ctx);
+
+  res = TEEC_InitializeContext(NULL, ctx);
   if (res != TEEC_SUCCESS)
     errx(1, "TEEC_InitializeContext failed with code 0x%x", res);
 
-  /*
-   * Open a session to the "attestation" PTA.
-   */
-  res = TEEC_OpenSession(&ctx, &sess, &uuid, TEEC_LOGIN_PUBLIC, NULL, NULL,
+  res = TEEC_OpenSession(ctx, sess, &uuid, TEEC_LOGIN_PUBLIC, NULL, NULL,
                          &err_origin);
   if (res != TEEC_SUCCESS)
     errx(1, "TEEC_Opensession failed with code 0x%x origin 0x%x", res,
          err_origin);
+}
 
-  /*
-   * Execute a function in the TA by invoking it.
-   */
+/* Register a host buffer so the TA can use it in place */
+static void register_shm(TEEC_Context *ctx, TEEC_SharedMemory *shm,
+                         void *buffer, size_t size, uint32_t flags) {
+  TEEC_Result res;
+
+  memset(shm, 0, sizeof(*shm));
+  shm->buffer = buffer;
+  shm->size = size;
+  shm->flags = flags;
+
+  res = TEEC_RegisterSharedMemory(ctx, shm);
+  if (res != TEEC_SUCCESS)
+    errx(1, "TEEC_RegisterSharedMemory failed with code 0x%x", res);
+}
+
+/* Fetch the profile of the command just run on `sess` */
+static void query_profile(TEEC_Session *sess, struct ta_profile *profile) {
+  TEEC_Result res;
+  TEEC_Operation op;
+  uint32_t err_origin = 0;
 
-  /* Clear the TEEC_Operation struct */
   memset(&op, 0, sizeof(op));
+  op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_OUTPUT, TEEC_VALUE_OUTPUT,
+                                   TEEC_VALUE_OUTPUT, TEEC_VALUE_OUTPUT);
+
+  res = TEEC_InvokeCommand(sess, TA_SS_TEST_CMD_PROFILE, &op, &err_origin);
+  if (res == TEEC_ERROR_NOT_SUPPORTED)
+    errx(1, "The TA was built without CFG_DEXO_SSS_PROFILE=y");
+  if (res != TEEC_SUCCESS)
+    errx(1, "TEEC_InvokeCommand failed with code 0x%x origin 0x%x", res,
+         err_origin);
+
+  profile->random_us = op.params[0].value.a;
+  profile->evaluate_us = op.params[0].value.b;
+  profile->encode_us = op.params[1].value.a;
+  profile->alloc_us = op.params[1].value.b;
+  profile->heap_max = op.params[2].value.a;
+  profile->heap_size = op.params[2].value.b;
+  profile->lib_allocs = op.params[3].value.a;
+  profile->lib_peak = op.params[3].value.b;
+}
+
+/*
+ * Split the `len` byte secret in `secret_shm` into the share lines in
+ * `shares_shm` with TA_SS_TEST_CMD_SPLIT_SHM. Returns the time the TA spent
+ * splitting.
+ */
+static uint32_t split_shm(TEEC_Session *sess, TEEC_SharedMemory *secret_shm,
+                          TEEC_SharedMemory *shares_shm, uint32_t n,
+                          uint32_t t, uint32_t len) {
+  TEEC_Result res;
+  TEEC_Operation op;
+  uint32_t err_origin = 0;
 
   /*
-   * Prepare the argument.
-   * TEEC_TempMemoryReference
+   * Split: (n, t) and the secret go in, the shares and the time spent in
+   * the TA come back out.
    */
+  memset(&op, 0, sizeof(op));
+  op.paramTypes =
+      TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_MEMREF_PARTIAL_INPUT,
+                       TEEC_MEMREF_PARTIAL_OUTPUT, TEEC_VALUE_OUTPUT);
+  op.params[0].value.a = n;
+  op.params[0].value.b = t;
+  op.params[1].memref.parent = secret_shm;
+  op.params[1].memref.size = len;
+  op.params[2].memref.parent = shares_shm;
+  op.params[2].memref.size = (6 + 2 * (size_t)len + 1) * n;
+
+  res = TEEC_InvokeCommand(sess, TA_SS_TEST_CMD_SPLIT_SHM, &op, &err_origin);
+  if (res != TEEC_SUCCESS)
+    errx(1, "TEEC_InvokeCommand failed with code 0x%x origin 0x%x", res,
+         err_origin);
+
+  return op.params[3].value.a;
+}
+
+/*
+ * Split the secret in `secret_shm` a chunk at a time with the
+ * TA_SS_TEST_CMD_SPLIT_* commands and assemble the share lines in `shares`.
+ * The rows of every chunk come back through `rows_shm`. Returns the time the
+ * TA spent splitting.
+ */
+static uint32_t split_chunked(TEEC_Session *sess, TEEC_SharedMemory *secret_shm,
+                              TEEC_SharedMemory *rows_shm, uint32_t n,
+                              uint32_t t, uint32_t len, char *shares) {
+  TEEC_Result res;
+  TEEC_Operation op;
+  uint32_t err_origin = 0;
+  uint32_t ta_ms = 0;
+  size_t stride = 6 + 2 * (size_t)len + 1;
+  char *rows = rows_shm->buffer;
+
+  /* Open the job; the share headers come back in the rows buffer */
+  memset(&op, 0, sizeof(op));
+  op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_VALUE_INPUT,
+                                   TEEC_MEMREF_PARTIAL_OUTPUT, TEEC_NONE);
+  op.params[0].value.a = n;
+  op.params[0].value.b = t;
+  op.params[1].value.a = len;
+  op.params[2].memref.parent = rows_shm;
+  op.params[2].memref.size = 6 * n;
+
+  res = TEEC_InvokeCommand(sess, TA_SS_TEST_CMD_SPLIT_OPEN, &op, &err_origin);
+  if (res != TEEC_SUCCESS)
+    errx(1, "TEEC_InvokeCommand failed with code 0x%x origin 0x%x", res,
+         err_origin);
+
+  for (uint32_t i = 0; i < n; i++) {
+    memcpy(shares + i * stride, rows + 6 * i, 6);
+    shares[i * stride + stride - 1] = '\n';
+  }
+
+  /* Feed the secret in place, one window of secret_shm at a time */
+  for (uint32_t done = 0; done < len;) {
+    uint32_t take = len - done < chunk_size ? len - done : chunk_size;
+
+    memset(&op, 0, sizeof(op));
+    op.paramTypes =
+        TEEC_PARAM_TYPES(TEEC_MEMREF_PARTIAL_INPUT, TEEC_MEMREF_PARTIAL_OUTPUT,
+                         TEEC_VALUE_OUTPUT, TEEC_NONE);
+    op.params[0].memref.parent = secret_shm;
+    op.params[0].memref.offset = done;
+    op.params[0].memref.size = take;
+    op.params[1].memref.parent = rows_shm;
+    op.params[1].memref.size = 2 * (size_t)take * n;
+
+    res = TEEC_InvokeCommand(sess, TA_SS_TEST_CMD_SPLIT_FEED, &op, &err_origin);
+    if (res != TEEC_SUCCESS)
+      errx(1, "TEEC_InvokeCommand failed with code 0x%x origin 0x%x", res,
+           err_origin);
+
+    for (uint32_t i = 0; i < n; i++)
+      memcpy(shares + i * stride + 6 + 2 * (size_t)done,
+             rows + i * 2 * (size_t)take, 2 * (size_t)take);
+
+    ta_ms += op.params[2].value.b;
+    done += take;
+  }
+
+  memset(&op, 0, sizeof(op));
   op.paramTypes = TEEC_PARAM_TYPES(TEEC_NONE, TEEC_NONE, TEEC_NONE, TEEC_NONE);
 
-  // TA_ATTESTATION_GET_DATA_SIGNATURE
-  res = TEEC_InvokeCommand(&sess, cmd, &op, &err_origin);
+  res = TEEC_InvokeCommand(sess, TA_SS_TEST_CMD_SPLIT_CLOSE, &op, &err_origin);
+  if (res != TEEC_SUCCESS)
+    errx(1, "TEEC_InvokeCommand failed with code 0x%x origin 0x%x", res,
+         err_origin);
+
+  return ta_ms;
+}
+
+/*
+ * The host side of one configuration: the secret, the shares and the joined
+ * secret, registered so the TA uses them in place, and with a chunk size set
+ * the buffer the chunked protocol returns its rows in. Set up once per
+ * configuration, so none of it is part of a timed run.
+ */
+struct ta_buffers {
+  char *secret;
+  char *shares;
+  char *joined;
+  char *rows;
+  TEEC_SharedMemory secret_shm;
+  TEEC_SharedMemory shares_shm;
+  TEEC_SharedMemory joined_shm;
+  TEEC_SharedMemory rows_shm;
+};
+
+/* Allocate and register the buffers for `len` bytes split into `n` shares */
+static void setup_buffers(TEEC_Context *ctx, struct ta_buffers *buf,
+                          uint32_t n, uint32_t len) {
+  /* Each share is a 6 character header, 2 characters per byte and a '\n' */
+  size_t stride = 6 + 2 * (size_t)len + 1;
+  size_t row = 2 * (size_t)chunk_size;
+  /* The rows buffer doubles as the destination for the 6-character headers */
+  size_t rows_size = (row < 6 ? 6 : row) * n;
+
+  memset(buf, 0, sizeof(*buf));
+  buf->secret = malloc(len);
+  buf->shares = malloc(stride * n);
+  buf->joined = malloc(len);
+  if (chunk_size) buf->rows = malloc(rows_size);
+
+  if (!buf->secret || !buf->shares || !buf->joined ||
+      (chunk_size && !buf->rows))
+    errx(1, "Out of memory");
+
+  for (uint32_t i = 0; i < len; i++) buf->secret[i] = rand();
+
+  register_shm(ctx, &buf->secret_shm, buf->secret, len, TEEC_MEM_INPUT);
+  register_shm(ctx, &buf->shares_shm, buf->shares, stride * n,
+               TEEC_MEM_INPUT | TEEC_MEM_OUTPUT);
+  register_shm(ctx, &buf->joined_shm, buf->joined, len, TEEC_MEM_OUTPUT);
+  if (chunk_size)
+    register_shm(ctx, &buf->rows_shm, buf->rows, rows_size, TEEC_MEM_OUTPUT);
+}
+
+static void release_buffers(struct ta_buffers *buf) {
+  TEEC_ReleaseSharedMemory(&buf->secret_shm);
+  TEEC_ReleaseSharedMemory(&buf->shares_shm);
+  TEEC_ReleaseSharedMemory(&buf->joined_shm);
+  if (buf->rows) TEEC_ReleaseSharedMemory(&buf->rows_shm);
+
+  free(buf->secret);
+  free(buf->shares);
+  free(buf->joined);
+  free(buf->rows);
+}
+
+/* Timings of one call_ta() run, in ms */
+struct ta_run {
+  double split_wall; /* Around the split invoke(s) */
+  double join_wall;  /* Around the join invoke */
+  uint32_t split_ms; /* Reported by the TA */
+  uint32_t join_ms;
+};
+
+/*
+ * Split the secret in `buf` into `n` shares with threshold `t` inside the TA,
+ * then join the last `t` shares back inside the TA and check that the secret
+ * survived. The secret goes in, and the shares come out, through registered
+ * shared memory, so nothing is copied on the way. With a chunk size set, the
+ * split goes through the chunked protocol instead. Only the invokes are
+ * timed, into `run`, and `profile`, if not NULL, receives the TA's profile of
+ * the split and of the join.
+ */
+static void call_ta(TEEC_Session *sess, struct ta_buffers *buf, uint32_t n,
+                    uint32_t t, uint32_t len, struct ta_run *run,
+                    struct ta_profile profile[2]) {
+  TEEC_Result res = TEEC_ERROR_GENERIC;
+  uint32_t err_origin = 0;
+  TEEC_Operation op = {};
+  size_t stride = 6 + 2 * (size_t)len + 1;
+  double start = now_ms();
+
+  if (chunk_size)
+    run->split_ms = split_chunked(sess, &buf->secret_shm, &buf->rows_shm, n,
+                                  t, len, buf->shares);
+  else
+    run->split_ms = split_shm(sess, &buf->secret_shm, &buf->shares_shm, n, t,
+                              len);
+  run->split_wall = now_ms() - start;
+
+  if (profile) query_profile(sess, &profile[0]);
+
+  /* Join: hand the TA the last t share lines in place */
+  memset(&op, 0, sizeof(op));
+  op.paramTypes =
+      TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_MEMREF_PARTIAL_INPUT,
+                       TEEC_MEMREF_PARTIAL_OUTPUT, TEEC_VALUE_OUTPUT);
+  op.params[0].value.a = t;
+  op.params[0].value.b = len;
+  op.params[1].memref.parent = &buf->shares_shm;
+  op.params[1].memref.offset = stride * (n - t);
+  op.params[1].memref.size = stride * t;
+  op.params[2].memref.parent = &buf->joined_shm;
+  op.params[2].memref.size = len;
+
+  start = now_ms();
+  res = TEEC_InvokeCommand(sess, TA_SS_TEST_CMD_JOIN_SHM, &op, &err_origin);
+  run->join_wall = now_ms() - start;
   if (res != TEEC_SUCCESS)
     errx(1, "TEEC_InvokeCommand failed with code 0x%x origin 0x%x", res,
          err_origin);
 
-  // data = op.params[0].value.a;
-  // data_signature = op.params[0].value.b;
-  // RT_signature = op.params[1].value.b;
-  // printf("Data: %u\n", data);
-  // printf("Data Signature: %u\n", data_signature);
-  // printf("RT Signature: %u\n", RT_signature);
+  run->join_ms = op.params[3].value.a;
+  if (profile) query_profile(sess, &profile[1]);
+
+  if (memcmp(buf->secret, buf->joined, len) != 0)
+    errx(1, "Joined secret does not match for n=%u t=%u", n, t);
+}
+
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+
+  return (x > y) - (x < y);
+}
+
+/* Sort `samples` and summarise them; percentiles are nearest-rank */
+static struct bench_stats summarize(double *samples, uint32_t count) {
+  struct bench_stats stats;
+
+  qsort(samples, count, sizeof(*samples), compare_double);
+  stats.min = samples[0];
+  stats.median = samples[(count - 1) / 2];
+  stats.p99 = samples[(count * 99 + 99) / 100 - 1];
+  return stats;
+}
+
+/* Pin this thread to `cpu`, so runs are not migrated between cores */
+static void pin_cpu(int cpu) {
+  cpu_set_t set;
+
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (sched_setaffinity(0, sizeof(set), &set) != 0)
+    err(1, "Cannot pin to CPU %d", cpu);
+}
+
+static void print_header(uint32_t len, double setup_ms) {
+  switch (output_format) {
+    case OUTPUT_TEXT:
+      printf("For %u B of data\n", len);
+      printf("Session setup: %f ms\n", setup_ms);
+      printf("%u warm-up and %u timed runs per configuration, "
+             "times in ms as min / median / p99\n",
+             warmup_runs, timed_runs);
+      break;
+    case OUTPUT_CSV:
+      if (batch_repeat)
+        printf("bytes,rule,n,t,splits,runs,single_min,single_median,"
+               "single_p99,single_ta_min,single_ta_median,single_ta_p99,"
+               "batch_min,batch_median,batch_p99,batch_ta_min,"
+               "batch_ta_median,batch_ta_p99,transition_ms\n");
+      else if (max_threads)
+        printf("bytes,rule,n,t,threads,runs,splits_per_s,mb_per_s,"
+               "latency_min,latency_median,latency_p99\n");
+      else
+        printf("bytes,rule,n,t,runs,session_setup_ms,split_wall_min,"
+               "split_wall_median,split_wall_p99,split_min,split_median,"
+               "split_p99,join_wall_min,join_wall_median,join_wall_p99,"
+               "join_min,join_median,join_p99%s\n",
+               profile_phases
+                   ? ",split_random_us,split_evaluate_us,split_encode_us,"
+                     "split_alloc_us,split_heap_max,split_lib_allocs,"
+                     "split_lib_peak,join_random_us,join_evaluate_us,"
+                     "join_encode_us,join_alloc_us,join_heap_max,"
+                     "join_lib_allocs,join_lib_peak"
+                   : "");
+      break;
+    case OUTPUT_JSON:
+      printf("{\"bytes\": %u, \"session_setup_ms\": %f, \"warmup_runs\": %u, "
+             "\"timed_runs\": %u, \"results\": [",
+             len, setup_ms, warmup_runs, timed_runs);
+      break;
+  }
+}
+
+static void print_footer(void) {
+  if (output_format == OUTPUT_JSON) printf("\n]}\n");
+}
+
+static void print_stats_json(const char *name, const struct bench_stats *s) {
+  printf("\"%s\": {\"min\": %f, \"median\": %f, \"p99\": %f}", name, s->min,
+         s->median, s->p99);
+}
+
+static void print_profile(const char *name, const struct ta_profile *p) {
+  switch (output_format) {
+    case OUTPUT_TEXT:
+      printf("  %s: random %u us, evaluate %u us, encode %u us, alloc %u us, "
+             "heap high-water %u of %u B, %u library allocations "
+             "(peak %u B)\n",
+             name, p->random_us, p->evaluate_us, p->encode_us, p->alloc_us,
+             p->heap_max, p->heap_size, p->lib_allocs, p->lib_peak);
+      break;
+    case OUTPUT_CSV:
+      printf(",%u,%u,%u,%u,%u,%u,%u", p->random_us, p->evaluate_us,
+             p->encode_us, p->alloc_us, p->heap_max, p->lib_allocs,
+             p->lib_peak);
+      break;
+    case OUTPUT_JSON:
+      printf(", \"%s_profile\": {\"random_us\": %u, \"evaluate_us\": %u, "
+             "\"encode_us\": %u, \"alloc_us\": %u, \"heap_max\": %u, "
+             "\"heap_size\": %u, \"lib_allocs\": %u, \"lib_peak\": %u}",
+             name, p->random_us, p->evaluate_us, p->encode_us, p->alloc_us,
+             p->heap_max, p->heap_size, p->lib_allocs, p->lib_peak);
+      break;
+  }
+}
+
+static void print_result(const struct bench_config *config, uint32_t len,
+                         double setup_ms, const struct bench_stats *split_wall,
+                         const struct bench_stats *split,
+                         const struct bench_stats *join_wall,
+                         const struct bench_stats *join,
+                         const struct ta_profile *profile, int first) {
+  switch (output_format) {
+    case OUTPUT_TEXT:
+      printf("n=%u t=%u: split %.3f / %.3f / %.3f (in TA %.0f / %.0f / %.0f), "
+             "join %.3f / %.3f / %.3f (in TA %.0f / %.0f / %.0f)\n",
+             config->n, config->t, split_wall->min, split_wall->median,
+             split_wall->p99, split->min, split->median, split->p99,
+             join_wall->min, join_wall->median, join_wall->p99, join->min,
+             join->median, join->p99);
+      break;
+    case OUTPUT_CSV:
+      printf("%u,%s,%u,%u,%u,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f", len,
+             config->rule, config->n, config->t, timed_runs, setup_ms,
+             split_wall->min, split_wall->median, split_wall->p99, split->min,
+             split->median, split->p99, join_wall->min, join_wall->median,
+             join_wall->p99, join->min, join->median, join->p99);
+      break;
+    case OUTPUT_JSON:
+      printf("%s\n  {\"rule\": \"%s\", \"n\": %u, \"t\": %u, ", first ? "" : ",",
+             config->rule, config->n, config->t);
+      print_stats_json("split_wall_ms", split_wall);
+      printf(", ");
+      print_stats_json("split_ms", split);
+      printf(", ");
+      print_stats_json("join_wall_ms", join_wall);
+      printf(", ");
+      print_stats_json("join_ms", join);
+      break;
+  }
+
+  if (profile) {
+    print_profile("split", &profile[0]);
+    print_profile("join", &profile[1]);
+  }
+
+  if (output_format == OUTPUT_CSV) printf("\n");
+  if (output_format == OUTPUT_JSON) printf("}");
+}
+
+/* One thread of the concurrent benchmark, with its own session */
+struct worker {
+  pthread_t thread;
+  const struct bench_config *config;
+  uint32_t len;
+  pthread_barrier_t *barrier;
+  int cpu;         /* CPU to run on, -1 for any */
+  double *latency; /* timed_runs per-split wall-clock times in ms */
+};
+
+static void *worker_main(void *arg) {
+  struct worker *w = arg;
+  TEEC_Context ctx = {};
+  TEEC_Session sess = {};
+  TEEC_SharedMemory secret_shm;
+  TEEC_SharedMemory shares_shm;
+  uint32_t n = w->config->n;
+  uint32_t t = w->config->t;
+  size_t stride = 6 + 2 * (size_t)w->len + 1;
+  char *secret = malloc(w->len);
+  char *shares = malloc(stride * n);
+
+  if (!secret || !shares) errx(1, "Out of memory");
+
+  if (w->cpu >= 0) pin_cpu(w->cpu);
+
+  for (uint32_t i = 0; i < w->len; i++) secret[i] = rand();
+
+  open_ta(&ctx, &sess);
+  register_shm(&ctx, &secret_shm, secret, w->len, TEEC_MEM_INPUT);
+  register_shm(&ctx, &shares_shm, shares, stride * n, TEEC_MEM_OUTPUT);
+
+  for (uint32_t i = 0; i < warmup_runs; i++)
+    split_shm(&sess, &secret_shm, &shares_shm, n, t, w->len);
+
+  /* Every thread starts, and is done, before the clock is read */
+  pthread_barrier_wait(w->barrier);
+  for (uint32_t i = 0; i < timed_runs; i++) {
+    double start = now_ms();
+
+    split_shm(&sess, &secret_shm, &shares_shm, n, t, w->len);
+    w->latency[i] = now_ms() - start;
+  }
+  pthread_barrier_wait(w->barrier);
+
+  TEEC_ReleaseSharedMemory(&secret_shm);
+  TEEC_ReleaseSharedMemory(&shares_shm);
   TEEC_CloseSession(&sess);
   TEEC_FinalizeContext(&ctx);
-  return 0;
+
+  free(secret);
+  free(shares);
+  return NULL;
 }
 
-int main(int argc, char *argv[]) {
-  if (argc < 2) {
-    printf("provide a number (size(B) of data)\n");
-    return 1;
+/*
+ * Split concurrently from 1, 2, ..., max_threads threads, each with its own
+ * session (and so its own TA instance), and print the aggregate throughput
+ * and the latency of a split as seen by one thread.
+ */
+static void run_threads(const struct bench_config *config, uint32_t len,
+                        int *first) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+  for (uint32_t k = 1; k <= max_threads; k++) {
+    struct worker *workers = calloc(k, sizeof(*workers));
+    double *latency = malloc(sizeof(double) * timed_runs * k);
+    pthread_barrier_t barrier;
+
+    if (!workers || !latency) errx(1, "Out of memory");
+
+    pthread_barrier_init(&barrier, NULL, k + 1);
+    for (uint32_t i = 0; i < k; i++) {
+      workers[i].config = config;
+      workers[i].len = len;
+      workers[i].barrier = &barrier;
+      /* With -p, worker i gets CPU -p + i, wrapping round */
+      workers[i].cpu = pin_base >= 0 ? (pin_base + i) % cpus : -1;
+      workers[i].latency = latency + i * timed_runs;
+      if (pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]))
+        errx(1, "Cannot create thread");
+    }
+
+    pthread_barrier_wait(&barrier);
+    double start = now_ms();
+    pthread_barrier_wait(&barrier);
+    double elapsed = now_ms() - start;
+
+    for (uint32_t i = 0; i < k; i++) pthread_join(workers[i].thread, NULL);
+    pthread_barrier_destroy(&barrier);
+
+    double splits_per_s = k * timed_runs / (elapsed / 1000.0);
+    double mb_per_s = splits_per_s * len / 1000000.0;
+    struct bench_stats stats = summarize(latency, timed_runs * k);
+
+    switch (output_format) {
+      case OUTPUT_TEXT:
+        printf("n=%u t=%u, %u threads: %.1f splits/s (%.3f MB/s), "
+               "latency %.3f / %.3f / %.3f\n",
+               config->n, config->t, k, splits_per_s, mb_per_s, stats.min,
+               stats.median, stats.p99);
+        break;
+      case OUTPUT_CSV:
+        printf("%u,%s,%u,%u,%u,%u,%f,%f,%f,%f,%f\n", len, config->rule,
+               config->n, config->t, k, timed_runs, splits_per_s, mb_per_s,
+               stats.min, stats.median, stats.p99);
+        break;
+      case OUTPUT_JSON:
+        printf("%s\n  {\"rule\": \"%s\", \"n\": %u, \"t\": %u, "
+               "\"threads\": %u, \"splits_per_s\": %f, \"mb_per_s\": %f, ",
+               *first ? "" : ",", config->rule, config->n, config->t, k,
+               splits_per_s, mb_per_s);
+        print_stats_json("latency_ms", &stats);
+        printf("}");
+        break;
+    }
+    *first = 0;
+
+    free(workers);
+    free(latency);
   }
+}
 
-  // int num = 10;
-  int num = atoi(argv[1]);
-  int cmd_ids[] = {TA_SS_TEST_5,       TA_SS_TEST_10,      TA_SS_TEST_20,
-                   TA_SS_TEST_30,      TA_SS_TEST_40,      TA_SS_TEST_50,
-                   TA_SS_TEST_5_half,  TA_SS_TEST_10_half, TA_SS_TEST_20_half,
-                   TA_SS_TEST_30_half, TA_SS_TEST_40_half, TA_SS_TEST_50_half};
-  clock_t start, end;
-  printf("For %d B of data\n", num);
-  switch (num) {
-    case 10:
-      for (int i = 0; i < sizeof(cmd_ids) / sizeof(cmd_ids[0]); i++) {
-        start = clock();
-        double time_taken;
-        printf("Start for cmd_id %d\n", cmd_ids[i]);
-        for (int j = 0; j < 1; j++) {
-          switch (cmd_ids[i]) {
-            case TA_SS_TEST_5:
-              call_ta(TA_SS_TEST_5);
-              break;
-            case TA_SS_TEST_10:
-              call_ta(TA_SS_TEST_10);
-              break;
-            case TA_SS_TEST_20:
-              call_ta(TA_SS_TEST_20);
-              break;
-            case TA_SS_TEST_30:
-              call_ta(TA_SS_TEST_30);
-              break;
-            case TA_SS_TEST_40:
-              call_ta(TA_SS_TEST_40);
-              break;
-            case TA_SS_TEST_50:
-              call_ta(TA_SS_TEST_50);
-              break;
-            case TA_SS_TEST_5_half:
-              call_ta(TA_SS_TEST_5_half);
-              break;
-            case TA_SS_TEST_10_half:
-              call_ta(TA_SS_TEST_10_half);
-              break;
-            case TA_SS_TEST_20_half:
-              call_ta(TA_SS_TEST_20_half);
-              break;
-            case TA_SS_TEST_30_half:
-              call_ta(TA_SS_TEST_30_half);
-              break;
-            case TA_SS_TEST_40_half:
-              call_ta(TA_SS_TEST_40_half);
-              break;
-            case TA_SS_TEST_50_half:
-              call_ta(TA_SS_TEST_50_half);
-              break;
-            default:
-              break;
-          }
-        }
+/* One TA_SS_TEST_CMD_SPLIT_BATCH invoke running `job` `repeat` times */
+static uint32_t split_batch(TEEC_Session *sess, TEEC_SharedMemory *secret_shm,
+                            TEEC_SharedMemory *shares_shm,
+                            struct ss_test_job *job, uint32_t repeat) {
+  TEEC_Result res;
+  uint32_t err_origin = 0;
+  TEEC_Operation op;
 
-        end = clock();
-        time_taken = ((double)end - start) / CLOCKS_PER_SEC *
-                     1000.0;  // Convert to milliseconds
-        printf("Time taken for cmd_id %d(1): %f ms\n", cmd_ids[i], time_taken);
-      }
-      // for (int i = 0; i < sizeof(cmd_ids) / sizeof(cmd_ids[0]); i++) {
-      //   start = clock();
-      //   double time_taken;
-      //   printf("Start for cmd_id %d\n", cmd_ids[i]);
-      //   for (int j = 0; j < 10; j++) {
-      //     switch (cmd_ids[i]) {
-      //       case TA_SS_TEST_5:
-      //         call_ta(TA_SS_TEST_5);
-      //         break;
-      //       case TA_SS_TEST_10:
-      //         call_ta(TA_SS_TEST_10);
-      //         break;
-      //       case TA_SS_TEST_20:
-      //         call_ta(TA_SS_TEST_20);
-      //         break;
-      //       case TA_SS_TEST_30:
-      //         call_ta(TA_SS_TEST_30);
-      //         break;
-      //       case TA_SS_TEST_40:
-      //         call_ta(TA_SS_TEST_40);
-      //         break;
-      //       case TA_SS_TEST_50:
-      //         call_ta(TA_SS_TEST_50);
-      //         break;
-      //       case TA_SS_TEST_5_half:
-      //         call_ta(TA_SS_TEST_5_half);
-      //         break;
-      //       case TA_SS_TEST_10_half:
-      //         call_ta(TA_SS_TEST_10_half);
-      //         break;
-      //       case TA_SS_TEST_20_half:
-      //         call_ta(TA_SS_TEST_20_half);
-      //         break;
-      //       case TA_SS_TEST_30_half:
-      //         call_ta(TA_SS_TEST_30_half);
-      //         break;
-      //       case TA_SS_TEST_40_half:
-      //         call_ta(TA_SS_TEST_40_half);
-      //         break;
-      //       case TA_SS_TEST_50_half:
-      //         call_ta(TA_SS_TEST_50_half);
-      //         break;
-      //       default:
-      //         break;
-      //     }
-      //   }
-
-      //   end = clock();
-      //   time_taken = ((double)end - start) / CLOCKS_PER_SEC *
-      //                1000.0;  // Convert to milliseconds
-      //   printf("Time taken for cmd_id %d(10): %f ms\n", cmd_ids[i], time_taken);
-      // }
-      break;
-    case 100:
-      for (int i = 0; i < sizeof(cmd_ids) / sizeof(cmd_ids[0]); i++) {
-        start = clock();
-        double time_taken;
-        printf("Start for cmd_id %d\n", cmd_ids[i]);
-        for (int j = 0; j < 1; j++) {
-          switch (cmd_ids[i]) {
-            case TA_SS_TEST_5_100bytes:
-              call_ta(TA_SS_TEST_5_100bytes);
-              break;
-            case TA_SS_TEST_10_100bytes:
-              call_ta(TA_SS_TEST_10_100bytes);
-              break;
-            case TA_SS_TEST_20_100bytes:
-              call_ta(TA_SS_TEST_20_100bytes);
-              break;
-            case TA_SS_TEST_30_100bytes:
-              call_ta(TA_SS_TEST_30_100bytes);
-              break;
-            case TA_SS_TEST_40_100bytes:
-              call_ta(TA_SS_TEST_40_100bytes);
-              break;
-            case TA_SS_TEST_50_100bytes:
-              call_ta(TA_SS_TEST_50_100bytes);
-              break;
-            case TA_SS_TEST_5_half_100bytes:
-              call_ta(TA_SS_TEST_5_half_100bytes);
-              break;
-            case TA_SS_TEST_10_half_100bytes:
-              call_ta(TA_SS_TEST_10_half_100bytes);
-              break;
-            case TA_SS_TEST_20_half_100bytes:
-              call_ta(TA_SS_TEST_20_half_100bytes);
-              break;
-            case TA_SS_TEST_30_half_100bytes:
-              call_ta(TA_SS_TEST_30_half_100bytes);
-              break;
-            case TA_SS_TEST_40_half_100bytes:
-              call_ta(TA_SS_TEST_40_half_100bytes);
-              break;
-            case TA_SS_TEST_50_half_100bytes:
-              call_ta(TA_SS_TEST_50_half_100bytes);
-              break;
-            default:
-              break;
-          }
-        }
+  memset(&op, 0, sizeof(op));
+  op.paramTypes =
+      TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INOUT, TEEC_MEMREF_PARTIAL_INPUT,
+                       TEEC_MEMREF_PARTIAL_OUTPUT, TEEC_VALUE_INOUT);
+  op.params[0].tmpref.buffer = job;
+  op.params[0].tmpref.size = sizeof(*job);
+  op.params[1].memref.parent = secret_shm;
+  op.params[1].memref.size = job->len;
+  op.params[2].memref.parent = shares_shm;
+  op.params[2].memref.size = shares_shm->size;
+  op.params[3].value.a = repeat;
 
-        end = clock();
-        time_taken = ((double)end - start) / CLOCKS_PER_SEC *
-                     1000.0;  // Convert to milliseconds
-        printf("Time taken for cmd_id %d(1): %f ms\n", cmd_ids[i], time_taken);
-      }
-      for (int i = 0; i < sizeof(cmd_ids) / sizeof(cmd_ids[0]); i++) {
-        start = clock();
-        double time_taken;
-        printf("Start for cmd_id %d\n", cmd_ids[i]);
-        for (int j = 0; j < 10; j++) {
-          switch (cmd_ids[i]) {
-            case TA_SS_TEST_5_100bytes:
-              call_ta(TA_SS_TEST_5_100bytes);
-              break;
-            case TA_SS_TEST_10_100bytes:
-              call_ta(TA_SS_TEST_10_100bytes);
-              break;
-            case TA_SS_TEST_20_100bytes:
-              call_ta(TA_SS_TEST_20_100bytes);
-              break;
-            case TA_SS_TEST_30_100bytes:
-              call_ta(TA_SS_TEST_30_100bytes);
-              break;
-            case TA_SS_TEST_40_100bytes:
-              call_ta(TA_SS_TEST_40_100bytes);
-              break;
-            case TA_SS_TEST_50_100bytes:
-              call_ta(TA_SS_TEST_50_100bytes);
-              break;
-            case TA_SS_TEST_5_half_100bytes:
-              call_ta(TA_SS_TEST_5_half_100bytes);
-              break;
-            case TA_SS_TEST_10_half_100bytes:
-              call_ta(TA_SS_TEST_10_half_100bytes);
-              break;
-            case TA_SS_TEST_20_half_100bytes:
-              call_ta(TA_SS_TEST_20_half_100bytes);
-              break;
-            case TA_SS_TEST_30_half_100bytes:
-              call_ta(TA_SS_TEST_30_half_100bytes);
-              break;
-            case TA_SS_TEST_40_half_100bytes:
-              call_ta(TA_SS_TEST_40_half_100bytes);
-              break;
-            case TA_SS_TEST_50_half_100bytes:
-              call_ta(TA_SS_TEST_50_half_100bytes);
-              break;
-            default:
-              break;
-          }
-        }
+  res = TEEC_InvokeCommand(sess, TA_SS_TEST_CMD_SPLIT_BATCH, &op, &err_origin);
+  if (res != TEEC_SUCCESS)
+    errx(1, "TEEC_InvokeCommand failed with code 0x%x origin 0x%x", res,
+         err_origin);
 
-        end = clock();
-        time_taken = ((double)end - start) / CLOCKS_PER_SEC *
-                     1000.0;  // Convert to milliseconds
-        printf("Time taken for cmd_id %d(10): %f ms\n", cmd_ids[i], time_taken);
-      }
-      break;
-    case 1000:
-      for (int i = 0; i < sizeof(cmd_ids) / sizeof(cmd_ids[0]); i++) {
-        start = clock();
-        double time_taken;
-        printf("Start for cmd_id %d\n", cmd_ids[i]);
-        for (int j = 0; j < 1; j++) {
-          switch (cmd_ids[i]) {
-            case TA_SS_TEST_5_1000bytes:
-              call_ta(TA_SS_TEST_5_1000bytes);
-              break;
-            case TA_SS_TEST_10_1000bytes:
-              call_ta(TA_SS_TEST_10_1000bytes);
-              break;
-            case TA_SS_TEST_20_1000bytes:
-              call_ta(TA_SS_TEST_20_1000bytes);
-              break;
-            case TA_SS_TEST_30_1000bytes:
-              call_ta(TA_SS_TEST_30_1000bytes);
-              break;
-            case TA_SS_TEST_40_1000bytes:
-              call_ta(TA_SS_TEST_40_1000bytes);
-              break;
-            case TA_SS_TEST_50_1000bytes:
-              call_ta(TA_SS_TEST_50_1000bytes);
-              break;
-            case TA_SS_TEST_5_half_1000bytes:
-              call_ta(TA_SS_TEST_5_half_1000bytes);
-              break;
-            case TA_SS_TEST_10_half_1000bytes:
-              call_ta(TA_SS_TEST_10_half_1000bytes);
-              break;
-            case TA_SS_TEST_20_half_1000bytes:
-              call_ta(TA_SS_TEST_20_half_1000bytes);
-              break;
-            case TA_SS_TEST_30_half_1000bytes:
-              call_ta(TA_SS_TEST_30_half_1000bytes);
-              break;
-            case TA_SS_TEST_40_half_1000bytes:
-              call_ta(TA_SS_TEST_40_half_1000bytes);
-              break;
-            case TA_SS_TEST_50_half_1000bytes:
-              call_ta(TA_SS_TEST_50_half_1000bytes);
-              break;
-            default:
-              break;
-          }
-        }
+  return job->ms;
+}
 
-        end = clock();
-        time_taken = ((double)end - start) / CLOCKS_PER_SEC *
-                     1000.0;  // Convert to milliseconds
-        printf("Time taken for cmd_id %d(1): %f ms\n", cmd_ids[i], time_taken);
-      }
-      // for (int i = 0; i < sizeof(cmd_ids) / sizeof(cmd_ids[0]); i++) {
-      //   start = clock();
-      //   double time_taken;
-      //   printf("Start for cmd_id %d\n", cmd_ids[i]);
-      //   for (int j = 0; j < 10; j++) {
-      //     switch (cmd_ids[i]) {
-      //       case TA_SS_TEST_5_1000bytes:
-      //         call_ta(TA_SS_TEST_5_1000bytes);
-      //         break;
-      //       case TA_SS_TEST_10_1000bytes:
-      //         call_ta(TA_SS_TEST_10_1000bytes);
-      //         break;
-      //       case TA_SS_TEST_20_1000bytes:
-      //         call_ta(TA_SS_TEST_20_1000bytes);
-      //         break;
-      //       case TA_SS_TEST_30_1000bytes:
-      //         call_ta(TA_SS_TEST_30_1000bytes);
-      //         break;
-      //       case TA_SS_TEST_40_1000bytes:
-      //         call_ta(TA_SS_TEST_40_1000bytes);
-      //         break;
-      //       case TA_SS_TEST_50_1000bytes:
-      //         call_ta(TA_SS_TEST_50_1000bytes);
-      //         break;
-      //       case TA_SS_TEST_5_half_1000bytes:
-      //         call_ta(TA_SS_TEST_5_half_1000bytes);
-      //         break;
-      //       case TA_SS_TEST_10_half_1000bytes:
-      //         call_ta(TA_SS_TEST_10_half_1000bytes);
-      //         break;
-      //       case TA_SS_TEST_20_half_1000bytes:
-      //         call_ta(TA_SS_TEST_20_half_1000bytes);
-      //         break;
-      //       case TA_SS_TEST_30_half_1000bytes:
-      //         call_ta(TA_SS_TEST_30_half_1000bytes);
-      //         break;
-      //       case TA_SS_TEST_40_half_1000bytes:
-      //         call_ta(TA_SS_TEST_40_half_1000bytes);
-      //         break;
-      //       case TA_SS_TEST_50_half_1000bytes:
-      //         call_ta(TA_SS_TEST_50_half_1000bytes);
-      //         break;
-      //       default:
-      //         break;
-      //     }
-      //   }
-
-      //   end = clock();
-      //   time_taken = ((double)end - start) / CLOCKS_PER_SEC *
-      //                1000.0;  // Convert to milliseconds
-      //   printf("Time taken for cmd_id %d(10): %f ms\n", cmd_ids[i], time_taken);
-      // }
+/*
+ * Split `len` bytes of random data `batch_repeat` times, first with one
+ * TA_SS_TEST_CMD_SPLIT_SHM invoke per split and then with a single
+ * TA_SS_TEST_CMD_SPLIT_BATCH invoke, and print both timings. The difference
+ * is what entering and leaving the TA costs.
+ */
+static void run_batch(TEEC_Context *ctx, TEEC_Session *sess,
+                      const struct bench_config *config, uint32_t len,
+                      int first) {
+  TEEC_SharedMemory secret_shm;
+  TEEC_SharedMemory shares_shm;
+  uint32_t n = config->n;
+  uint32_t t = config->t;
+  uint32_t repeat = batch_repeat;
+  struct ss_test_job job = {n, t, 0, len, 0};
+  size_t stride = 6 + 2 * (size_t)len + 1;
+  char *secret = malloc(len);
+  char *shares = malloc(stride * n);
+  double *single = malloc(sizeof(double) * timed_runs * 4);
+  double *single_ta = single + timed_runs;
+  double *batch = single_ta + timed_runs;
+  double *batch_ta = batch + timed_runs;
+
+  if (!secret || !shares || !single) errx(1, "Out of memory");
+
+  for (uint32_t i = 0; i < len; i++) secret[i] = rand();
+
+  register_shm(ctx, &secret_shm, secret, len, TEEC_MEM_INPUT);
+  register_shm(ctx, &shares_shm, shares, stride * n, TEEC_MEM_OUTPUT);
+
+  for (uint32_t i = 0; i < warmup_runs; i++) {
+    for (uint32_t r = 0; r < repeat; r++)
+      split_shm(sess, &secret_shm, &shares_shm, n, t, len);
+    split_batch(sess, &secret_shm, &shares_shm, &job, repeat);
+  }
+
+  for (uint32_t i = 0; i < timed_runs; i++) {
+    uint32_t ta_ms = 0;
+    double start = now_ms();
+
+    /* One invoke per split */
+    for (uint32_t r = 0; r < repeat; r++)
+      ta_ms += split_shm(sess, &secret_shm, &shares_shm, n, t, len);
+    single[i] = now_ms() - start;
+    single_ta[i] = ta_ms;
+
+    /* All of them in one invoke */
+    start = now_ms();
+    batch_ta[i] = split_batch(sess, &secret_shm, &shares_shm, &job, repeat);
+    batch[i] = now_ms() - start;
+  }
+
+  struct bench_stats single_stats = summarize(single, timed_runs);
+  struct bench_stats single_ta_stats = summarize(single_ta, timed_runs);
+  struct bench_stats batch_stats = summarize(batch, timed_runs);
+  struct bench_stats batch_ta_stats = summarize(batch_ta, timed_runs);
+
+  /* From the medians; undefined for a single split */
+  double transition_ms =
+      repeat > 1 ? (single_stats.median - batch_stats.median) / (repeat - 1)
+                 : 0;
+
+  switch (output_format) {
+    case OUTPUT_TEXT:
+      printf("n=%u t=%u, %u splits: %u invokes %.3f / %.3f / %.3f "
+             "(in TA %.0f / %.0f / %.0f), 1 invoke %.3f / %.3f / %.3f "
+             "(in TA %.0f / %.0f / %.0f)\n",
+             n, t, repeat, repeat, single_stats.min, single_stats.median,
+             single_stats.p99, single_ta_stats.min, single_ta_stats.median,
+             single_ta_stats.p99, batch_stats.min, batch_stats.median,
+             batch_stats.p99, batch_ta_stats.min, batch_ta_stats.median,
+             batch_ta_stats.p99);
+      if (repeat > 1)
+        printf("Transition cost: %f ms per invoke\n", transition_ms);
+      break;
+    case OUTPUT_CSV:
+      printf("%u,%s,%u,%u,%u,%u,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,", len,
+             config->rule, n, t, repeat, timed_runs, single_stats.min,
+             single_stats.median, single_stats.p99, single_ta_stats.min,
+             single_ta_stats.median, single_ta_stats.p99, batch_stats.min,
+             batch_stats.median, batch_stats.p99, batch_ta_stats.min,
+             batch_ta_stats.median, batch_ta_stats.p99);
+      if (repeat > 1) printf("%f", transition_ms);
+      printf("\n");
       break;
-    case 10000:
-      for (int i = 0; i < sizeof(cmd_ids) / sizeof(cmd_ids[0]); i++) {
-        start = clock();
-        double time_taken;
-        printf("Start for cmd_id %d\n", cmd_ids[i]);
-        for (int j = 0; j < 1; j++) {
-          switch (cmd_ids[i]) {
-            case TA_SS_TEST_5_10000bytes:
-              call_ta(TA_SS_TEST_5_10000bytes);
-              break;
-            case TA_SS_TEST_10_10000bytes:
-              call_ta(TA_SS_TEST_10_10000bytes);
-              break;
-            case TA_SS_TEST_20_10000bytes:
-              call_ta(TA_SS_TEST_20_10000bytes);
-              break;
-            case TA_SS_TEST_30_10000bytes:
-              call_ta(TA_SS_TEST_30_10000bytes);
-              break;
-            case TA_SS_TEST_40_10000bytes:
-              call_ta(TA_SS_TEST_40_10000bytes);
-              break;
-            case TA_SS_TEST_50_10000bytes:
-              call_ta(TA_SS_TEST_50_10000bytes);
-              break;
-            case TA_SS_TEST_5_half_10000bytes:
-              call_ta(TA_SS_TEST_5_half_10000bytes);
-              break;
-            case TA_SS_TEST_10_half_10000bytes:
-              call_ta(TA_SS_TEST_10_half_10000bytes);
-              break;
-            case TA_SS_TEST_20_half_10000bytes:
-              call_ta(TA_SS_TEST_20_half_10000bytes);
-              break;
-            case TA_SS_TEST_30_half_10000bytes:
-              call_ta(TA_SS_TEST_30_half_10000bytes);
-              break;
-            case TA_SS_TEST_40_half_10000bytes:
-              call_ta(TA_SS_TEST_40_half_10000bytes);
-              break;
-            case TA_SS_TEST_50_half_10000bytes:
-              call_ta(TA_SS_TEST_50_half_10000bytes);
-              break;
-            default:
-              break;
-          }
+    case OUTPUT_JSON:
+      printf("%s\n  {\"rule\": \"%s\", \"n\": %u, \"t\": %u, \"splits\": %u, ",
+             first ? "" : ",", config->rule, n, t, repeat);
+      print_stats_json("single_ms", &single_stats);
+      printf(", ");
+      print_stats_json("single_ta_ms", &single_ta_stats);
+      printf(", ");
+      print_stats_json("batch_ms", &batch_stats);
+      printf(", ");
+      print_stats_json("batch_ta_ms", &batch_ta_stats);
+      if (repeat > 1)
+        printf(", \"transition_ms\": %f}", transition_ms);
+      else
+        printf(", \"transition_ms\": null}");
+      break;
+  }
+
+  TEEC_ReleaseSharedMemory(&secret_shm);
+  TEEC_ReleaseSharedMemory(&shares_shm);
+
+  free(secret);
+  free(shares);
+  free(single);
+}
+
+/* Benchmark one configuration: warm up, then time `timed_runs` runs */
+static void run_config(TEEC_Context *ctx, TEEC_Session *sess,
+                       const struct bench_config *config, uint32_t len,
+                       double setup_ms, int first) {
+  if (batch_repeat) {
+    run_batch(ctx, sess, config, len, first);
+    return;
+  }
+
+  if (max_threads) {
+    run_threads(config, len, &first);
+    return;
+  }
+
+  double *split_wall = malloc(sizeof(double) * timed_runs * 4);
+  double *split = split_wall + timed_runs;
+  double *join_wall = split + timed_runs;
+  double *join = join_wall + timed_runs;
+  struct ta_buffers buf;
+  struct ta_run run;
+
+  if (!split_wall) errx(1, "Out of memory");
+
+  setup_buffers(ctx, &buf, config->n, len);
+
+  for (uint32_t i = 0; i < warmup_runs; i++)
+    call_ta(sess, &buf, config->n, config->t, len, &run, NULL);
+
+  for (uint32_t i = 0; i < timed_runs; i++) {
+    call_ta(sess, &buf, config->n, config->t, len, &run, NULL);
+    split_wall[i] = run.split_wall;
+    split[i] = run.split_ms;
+    join_wall[i] = run.join_wall;
+    join[i] = run.join_ms;
+  }
+
+  /* One more, untimed, run to read the TA's profile */
+  struct ta_profile profile[2] = {};
+
+  if (profile_phases)
+    call_ta(sess, &buf, config->n, config->t, len, &run, profile);
+
+  release_buffers(&buf);
+
+  struct bench_stats split_wall_stats = summarize(split_wall, timed_runs);
+  struct bench_stats split_stats = summarize(split, timed_runs);
+  struct bench_stats join_wall_stats = summarize(join_wall, timed_runs);
+  struct bench_stats join_stats = summarize(join, timed_runs);
+
+  print_result(config, len, setup_ms, &split_wall_stats, &split_stats,
+               &join_wall_stats, &join_stats, profile_phases ? profile : NULL,
+               first);
+  free(split_wall);
+}
+
+static void usage(const char *prog) {
+  printf("usage: %s [-b splits | -c chunk | -k threads|all] [-w warmup] "
+         "[-r runs] [-p cpu] [-f text|csv|json] [-P] <size(B) of data> [n t]\n"
+         "-P cannot be combined with -b, -c or -k\n",
+         prog);
+}
+
+int main(int argc, char *argv[]) {
+  const char *prog = argv[0];
+  int opt;
+
+  while ((opt = getopt(argc, argv, "b:c:k:w:r:p:f:P")) != -1) {
+    switch (opt) {
+      case 'b':
+        batch_repeat = atoi(optarg);
+        break;
+      case 'c':
+        chunk_size = atoi(optarg);
+        break;
+      case 'k':
+        if (strcmp(optarg, "all") == 0)
+          max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+        else
+          max_threads = atoi(optarg);
+        break;
+      case 'P':
+        profile_phases = 1;
+        break;
+      case 'w':
+        warmup_runs = atoi(optarg);
+        break;
+      case 'r':
+        timed_runs = atoi(optarg);
+        break;
+      case 'p':
+        pin_base = atoi(optarg);
+        break;
+      case 'f':
+        if (strcmp(optarg, "text") == 0) {
+          output_format = OUTPUT_TEXT;
+        } else if (strcmp(optarg, "csv") == 0) {
+          output_format = OUTPUT_CSV;
+        } else if (strcmp(optarg, "json") == 0) {
+          output_format = OUTPUT_JSON;
+        } else {
+          usage(prog);
+          return 1;
         }
+        break;
+      default:
+        usage(prog);
+        return 1;
+    }
+  }
+
+  /*
+   * Batch, thread and chunked mode each run something else. None profiles:
+   * the TA keeps the profile of one command, and a chunked split is many.
+   */
+  if ((batch_repeat != 0) + (max_threads != 0) + (chunk_size != 0) > 1 ||
+      (profile_phases && (batch_repeat || max_threads || chunk_size))) {
+    usage(prog);
+    return 1;
+  }
+
+  argc -= optind - 1;
+  argv += optind - 1;
+
+  if (argc != 2 && argc != 4) {
+    usage(prog);
+    return 1;
+  }
+
+  if (timed_runs < 1) {
+    printf("at least one timed run is needed\n");
+    return 1;
+  }
 
-        end = clock();
-        time_taken = ((double)end - start) / CLOCKS_PER_SEC *
-                     1000.0;  // Convert to milliseconds
-        printf("Time taken for cmd_id %d(1): %f ms\n", cmd_ids[i], time_taken);
+  uint32_t num = atoi(argv[1]);
+  if (num < 1) {
+    printf("size must be at least 1 byte\n");
+    return 1;
+  }
+
+  /* The table of configurations: one from the command line, or the matrix */
+  struct bench_config configs[sizeof(share_counts) / sizeof(share_counts[0]) *
+                              sizeof(threshold_rules) /
+                              sizeof(threshold_rules[0])];
+  size_t config_count = 0;
+
+  if (argc == 4) {
+    configs[config_count++] =
+        (struct bench_config){atoi(argv[2]), atoi(argv[3]), "-"};
+  } else {
+    for (size_t r = 0;
+         r < sizeof(threshold_rules) / sizeof(threshold_rules[0]); r++) {
+      for (size_t i = 0; i < sizeof(share_counts) / sizeof(share_counts[0]);
+           i++) {
+        uint32_t n = share_counts[i];
+        configs[config_count++] = (struct bench_config){
+            n, threshold_rules[r].threshold(n), threshold_rules[r].name};
       }
-      // for (int i = 0; i < sizeof(cmd_ids) / sizeof(cmd_ids[0]); i++) {
-      //   start = clock();
-      //   double time_taken;
-      //   printf("Start for cmd_id %d\n", cmd_ids[i]);
-      //   for (int j = 0; j < 10; j++) {
-      //     switch (cmd_ids[i]) {
-      //       case TA_SS_TEST_5_10000bytes:
-      //         call_ta(TA_SS_TEST_5_10000bytes);
-      //         break;
-      //       case TA_SS_TEST_10_10000bytes:
-      //         call_ta(TA_SS_TEST_10_10000bytes);
-      //         break;
-      //       case TA_SS_TEST_20_10000bytes:
-      //         call_ta(TA_SS_TEST_20_10000bytes);
-      //         break;
-      //       case TA_SS_TEST_30_10000bytes:
-      //         call_ta(TA_SS_TEST_30_10000bytes);
-      //         break;
-      //       case TA_SS_TEST_40_10000bytes:
-      //         call_ta(TA_SS_TEST_40_10000bytes);
-      //         break;
-      //       case TA_SS_TEST_50_10000bytes:
-      //         call_ta(TA_SS_TEST_50_10000bytes);
-      //         break;
-      //       case TA_SS_TEST_5_half_10000bytes:
-      //         call_ta(TA_SS_TEST_5_half_10000bytes);
-      //         break;
-      //       case TA_SS_TEST_10_half_10000bytes:
-      //         call_ta(TA_SS_TEST_10_half_10000bytes);
-      //         break;
-      //       case TA_SS_TEST_20_half_10000bytes:
-      //         call_ta(TA_SS_TEST_20_half_10000bytes);
-      //         break;
-      //       case TA_SS_TEST_30_half_10000bytes:
-      //         call_ta(TA_SS_TEST_30_half_10000bytes);
-      //         break;
-      //       case TA_SS_TEST_40_half_10000bytes:
-      //         call_ta(TA_SS_TEST_40_half_10000bytes);
-      //         break;
-      //       case TA_SS_TEST_50_half_10000bytes:
-      //         call_ta(TA_SS_TEST_50_half_10000bytes);
-      //         break;
-      //       default:
-      //         break;
-      //     }
-      //   }
-
-      //   end = clock();
-      //   time_taken = ((double)end - start) / CLOCKS_PER_SEC *
-      //                1000.0;  // Convert to milliseconds
-      //   printf("Time taken for cmd_id %d(10): %f ms\n", cmd_ids[i], time_taken);
-      // }
-      break;
-    default:
-      break;
+    }
   }
 
+  /* In thread mode every worker pins itself instead */
+  if (pin_base >= 0 && !max_threads) pin_cpu(pin_base);
+
+  /*
+   * One session serves every configuration, the way a long-running service
+   * would use the TA, so loading the TA is timed on its own.
+   */
+  TEEC_Context ctx = {};
+  TEEC_Session sess = {};
+  double start = now_ms();
+  open_ta(&ctx, &sess);
+  double setup_ms = now_ms() - start;
+
+  print_header(num, setup_ms);
+  for (size_t i = 0; i < config_count; i++)
+    run_config(&ctx, &sess, &configs[i], num, setup_ms, i == 0);
+  print_footer();
+
+  TEEC_CloseSession(&sess);
+  TEEC_FinalizeContext(&ctx);
   return 0;
 }
-// if (argc > 1) {
-//   int number = atoi(argv[1]);
-//   // printf("Converted number: %d\n", number);
-
-//   switch (number) {
-//     case 5:
-//       call_ta(TA_SS_TEST_5);
-//       break;
-//     case 10:
-//       call_ta(TA_SS_TEST_10);
-//       break;
-//     case 20:
-//       call_ta(TA_SS_TEST_20);
-//       break;
-//     case 30:
-//       call_ta(TA_SS_TEST_30);
-//       break;
-//     case 40:
-//       call_ta(TA_SS_TEST_40);
-//       break;
-//     case 50:
-//       call_ta(TA_SS_TEST_50);
-//       break;
-
-//     default:
-//       break;
-//   }
-// } else {
-//   printf("Please provide a number as an argument.\n");
-// }
-// return 0;
-// }
\ No newline at end of file
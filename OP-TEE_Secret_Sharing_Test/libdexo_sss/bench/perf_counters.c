@@ -0,0 +1,95 @@
+/*
+ * perf_event_open() counters for the native benchmark. Each counter is opened
+ * on its own so that one the PMU (or the container) does not offer does not
+ * take the others down; only user space is counted, which works with the
+ * default perf_event_paranoid of 2.
+ */
+
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "perf_counters.h"
+
+const char *const perf_counter_names[PERF_COUNTER_COUNT] = {
+    "cycles",      "instructions",  "l1d_misses",
+    "llc_misses",  "branch_misses", "page_faults",
+};
+
+static const struct {
+  uint32_t type;
+  uint64_t config;
+} events[PERF_COUNTER_COUNT] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+         PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+};
+
+static int fds[PERF_COUNTER_COUNT] = {-1, -1, -1, -1, -1, -1};
+
+int perf_counters_open(void) {
+  int count = 0;
+
+  for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = events[i].type;
+    attr.config = events[i].config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    /* More counters than the PMU has slots get multiplexed; scale them back */
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fds[i] >= 0) count++;
+  }
+  return count;
+}
+
+void perf_counters_close(void) {
+  for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+    if (fds[i] >= 0) close(fds[i]);
+    fds[i] = -1;
+  }
+}
+
+void perf_counters_start(void) {
+  for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+    if (fds[i] < 0) continue;
+    ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+    ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+void perf_counters_stop(double totals[PERF_COUNTER_COUNT]) {
+  for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+    if (fds[i] >= 0) ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+
+  for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+    uint64_t value[3]; /* value, time enabled, time running */
+
+    if (fds[i] < 0) continue;
+    if (read(fds[i], value, sizeof(value)) != sizeof(value)) continue;
+
+    if (value[2] && value[2] < value[1])
+      totals[i] += (double)value[0] * value[1] / value[2];
+    else
+      totals[i] += value[0];
+  }
+}
+
+int perf_counter_available(enum perf_counter counter) {
+  return fds[counter] >= 0;
+}
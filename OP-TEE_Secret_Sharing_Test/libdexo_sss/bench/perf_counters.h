@@ -0,0 +1,33 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+/* Hardware and software counters read around each benchmarked call */
+enum perf_counter {
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_L1D_MISSES,
+  PERF_LLC_MISSES,
+  PERF_BRANCH_MISSES,
+  PERF_PAGE_FAULTS,
+  PERF_COUNTER_COUNT
+};
+
+/// Names of the counters, as written to the JSON results
+extern const char *const perf_counter_names[PERF_COUNTER_COUNT];
+
+/// Open the counters for this process; returns how many are available
+int perf_counters_open(void);
+
+/// Close the counters
+void perf_counters_close(void);
+
+/// Reset and start the counters
+void perf_counters_start(void);
+
+/// Stop the counters and add their values to `totals` (left alone if unavailable)
+void perf_counters_stop(double totals[PERF_COUNTER_COUNT]);
+
+/// Whether `counter` could be opened
+int perf_counter_available(enum perf_counter counter);
+
+#endif
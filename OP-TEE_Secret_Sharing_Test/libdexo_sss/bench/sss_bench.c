@@ -0,0 +1,548 @@
+/*
+ * Native benchmark for libdexo_sss: runs the split/join matrix on the host,
+ * without a TEE, and optionally compares the results with a saved baseline.
+ */
+
+#include <err.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "perf_counters.h"
+#include "shamir.h"
+#ifdef DEXO_SSS_FIXED
+#include "shamir_fixed.h"
+#endif
+
+/* Default matrix */
+static const size_t default_counts[] = {5, 10, 20, 50, 100, 255};
+static const size_t default_sizes[] = {10,       100,       1000,     10000,
+                                       100000,   1000000,   10000000, 100000000};
+
+/* Threshold as a function of the number of shares */
+struct threshold_rule {
+  const char *name;
+  int (*threshold)(int n);
+};
+
+static int two_thirds(int n) { return (n * 2 + 2) / 3; }
+
+static int half(int n) { return (n + 1) / 2; }
+
+static const struct threshold_rule threshold_rules[] = {
+    {"2n/3", two_thirds},
+    {"n/2", half},
+};
+
+/* One line of results */
+struct bench_result {
+  char op[8];
+  size_t bytes;
+  int n;
+  int t;
+  char rule[8];
+  double mb_per_s;
+  double ns_per_byte_share;
+  long allocs;
+  long peak_rss_kb;
+  size_t alloc_bytes;  //!< Bytes the library allocated
+  size_t peak_bytes;   //!< Most bytes the library had allocated at once
+  double counters[PERF_COUNTER_COUNT]; //!< Per byte per share, < 0 if unavailable
+};
+
+/* Options */
+static int warmup_runs = 1;
+static int timed_runs = 5;
+static size_t memory_budget = (size_t)2000 * 1000000;
+static double time_budget_ns = 2e9;
+
+/* Use the compile-time specialised kernels where there is one (-F) */
+static int use_fixed = 0;
+
+/* Arena the library allocates from with -a, reset before every call */
+static struct shamir_arena arena;
+static char *arena_buffer = NULL;
+
+static double now_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * Start a new peak RSS measurement. Writing "5" to clear_refs resets the
+ * kernel's high-water mark (Linux 4.0+); where that fails the peak stays that
+ * of the process so far.
+ */
+static void reset_peak_rss(void) {
+  int fd = open("/proc/self/clear_refs", O_WRONLY);
+
+  if (fd < 0) return;
+  if (write(fd, "5", 1) != 1) {
+    /* Keep the process-wide peak */
+  }
+  close(fd);
+}
+
+/* Peak resident set size since reset_peak_rss() */
+static long peak_rss_kb(void) {
+  FILE *in = fopen("/proc/self/status", "r");
+  char line[128];
+  long kb = -1;
+
+  if (in) {
+    while (fgets(line, sizeof(line), in))
+      if (sscanf(line, "VmHWM: %ld kB", &kb) == 1) break;
+    fclose(in);
+  }
+
+  if (kb < 0) {
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+    kb = usage.ru_maxrss;
+  }
+  return kb;
+}
+
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+
+  return (x > y) - (x < y);
+}
+
+static double median(double *samples, int count) {
+  qsort(samples, count, sizeof(*samples), compare_double);
+  return samples[(count - 1) / 2];
+}
+
+/* Parse "10", "10K", "1M" and the like */
+static size_t parse_size(const char *text) {
+  char *end;
+  size_t value = strtoull(text, &end, 10);
+
+  switch (*end) {
+    case 'K':
+    case 'k':
+      return value * 1000;
+    case 'M':
+    case 'm':
+      return value * 1000000;
+    case 'G':
+    case 'g':
+      return value * 1000000000;
+    case '\0':
+      return value;
+    default:
+      errx(1, "Bad size '%s'", text);
+  }
+}
+
+/* Parse a comma separated list into `values`; returns the count */
+static size_t parse_list(char *text, size_t *values, size_t max) {
+  size_t count = 0;
+
+  for (char *item = strtok(text, ","); item; item = strtok(NULL, ",")) {
+    if (count == max) errx(1, "Too many values");
+    values[count++] = parse_size(item);
+  }
+  return count;
+}
+
+static void fill_result(struct bench_result *r, const char *op, size_t bytes,
+                        int n, int t, const char *rule, double ns, int shares,
+                        const struct shamir_alloc_stats *allocs,
+                        const double *totals, int runs) {
+  snprintf(r->op, sizeof(r->op), "%s", op);
+  snprintf(r->rule, sizeof(r->rule), "%s", rule);
+  r->bytes = bytes;
+  r->n = n;
+  r->t = t;
+  r->mb_per_s = bytes / (ns / 1e9) / 1e6;
+  r->ns_per_byte_share = ns / ((double)bytes * shares);
+  r->allocs = allocs->allocs;
+  r->alloc_bytes = allocs->bytes;
+  r->peak_bytes = allocs->peak_bytes;
+  r->peak_rss_kb = peak_rss_kb();
+
+  for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+    r->counters[i] = perf_counter_available(i)
+                         ? totals[i] / runs / ((double)bytes * shares)
+                         : -1;
+}
+
+static int run_split(const char *secret, size_t len, int n, int t, char *buffer) {
+#ifdef DEXO_SSS_FIXED
+  if (use_fixed) {
+    int ok = write_share_strings_fixed(secret, len, n, t, buffer);
+    if (ok >= 0) return ok;
+  }
+#endif
+  return write_share_strings(secret, len, n, t, buffer);
+}
+
+static int run_join(char **shares, int t, size_t len, char *joined) {
+#ifdef DEXO_SSS_FIXED
+  if (use_fixed) {
+    int ok = join_strings_range_into_fixed(shares, t, 0, len, joined);
+    if (ok >= 0) return ok;
+  }
+#endif
+  return join_strings_range_into(shares, t, 0, len, joined);
+}
+
+/*
+ * Split `len` random bytes into `n` shares and join them back from the last
+ * `t`, timing both. Returns 0 if the shares would not fit the memory budget.
+ */
+static int run_config(size_t len, int n, int t, const char *rule,
+                      struct bench_result *split, struct bench_result *join) {
+  size_t size = share_strings_size(len, n);
+  size_t stride = size / n;
+
+  if (size > memory_budget) return 0;
+
+  char *secret = malloc(len);
+  char *buffer = malloc(size);
+  char *joined = malloc(len);
+  char **shares = malloc(sizeof(char *) * t);
+  double *samples = malloc(sizeof(double) * timed_runs);
+  struct shamir_alloc_stats allocs;
+  double totals[PERF_COUNTER_COUNT];
+  double spent;
+  int runs;
+
+  if (!secret || !buffer || !joined || !shares || !samples)
+    errx(1, "Out of memory");
+
+  for (size_t i = 0; i < len; i++) secret[i] = rand();
+  for (int i = 0; i < t; i++) shares[i] = buffer + (n - t + i) * stride;
+
+  /* Split */
+  reset_peak_rss();
+  for (int i = 0; i < warmup_runs; i++)
+    run_split(secret, len, n, t, buffer);
+
+  /* Stop early once a slow configuration has used up the time budget */
+  memset(totals, 0, sizeof(totals));
+  for (runs = 0, spent = 0; runs < timed_runs && spent < time_budget_ns;
+       runs++) {
+    perf_counters_start();
+    double start = now_ns();
+
+    shamir_alloc_stats_reset();
+    if (arena_buffer) shamir_use_arena(&arena);
+    if (!run_split(secret, len, n, t, buffer))
+      errx(1, "Split failed for n=%d t=%d", n, t);
+    samples[runs] = now_ns() - start;
+    perf_counters_stop(totals);
+    spent += samples[runs];
+    shamir_alloc_stats_get(&allocs);
+  }
+  fill_result(split, "split", len, n, t, rule, median(samples, runs), n,
+              &allocs, totals, runs);
+
+  /* Join */
+  reset_peak_rss();
+  for (int i = 0; i < warmup_runs; i++)
+    run_join(shares, t, len, joined);
+
+  memset(totals, 0, sizeof(totals));
+  for (runs = 0, spent = 0; runs < timed_runs && spent < time_budget_ns;
+       runs++) {
+    perf_counters_start();
+    double start = now_ns();
+
+    shamir_alloc_stats_reset();
+    if (arena_buffer) shamir_use_arena(&arena);
+    if (!run_join(shares, t, len, joined))
+      errx(1, "Join failed for n=%d t=%d", n, t);
+    samples[runs] = now_ns() - start;
+    perf_counters_stop(totals);
+    spent += samples[runs];
+    shamir_alloc_stats_get(&allocs);
+  }
+  fill_result(join, "join", len, n, t, rule, median(samples, runs), t,
+              &allocs, totals, runs);
+
+  if (memcmp(secret, joined, len) != 0)
+    errx(1, "Joined secret does not match for n=%d t=%d", n, t);
+
+  free(secret);
+  free(buffer);
+  free(joined);
+  free(shares);
+  free(samples);
+  return 1;
+}
+
+/*
+ * One result per line, so that read_baseline() can scan it back. The counters
+ * come last, which keeps the leading fields in a fixed order.
+ */
+static void write_result(FILE *out, const struct bench_result *r, int first) {
+  fprintf(out,
+          "%s\n  {\"op\": \"%s\", \"bytes\": %zu, \"n\": %d, \"t\": %d, "
+          "\"rule\": \"%s\", \"mb_per_s\": %f, \"ns_per_byte_share\": %f, "
+          "\"allocs\": %ld, \"peak_rss_kb\": %ld, \"per_byte_share\": {",
+          first ? "" : ",", r->op, r->bytes, r->n, r->t, r->rule, r->mb_per_s,
+          r->ns_per_byte_share, r->allocs, r->peak_rss_kb);
+
+  for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+    fprintf(out, "%s\"%s\": ", i ? ", " : "", perf_counter_names[i]);
+    if (r->counters[i] < 0)
+      fprintf(out, "null");
+    else
+      fprintf(out, "%f", r->counters[i]);
+  }
+  fprintf(out, "}, \"alloc_bytes\": %zu, \"peak_alloc_bytes\": %zu}",
+          r->alloc_bytes, r->peak_bytes);
+}
+
+/* Counters per byte per share, on a line of their own */
+static void print_counters(const struct bench_result *r) {
+  int printed = 0;
+
+  for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+    if (r->counters[i] < 0) continue;
+    fprintf(stderr, "%s %s %.4f", printed ? "," : "      per byte/share:",
+            perf_counter_names[i], r->counters[i]);
+    printed = 1;
+  }
+
+  if (r->counters[PERF_CYCLES] > 0 && r->counters[PERF_INSTRUCTIONS] >= 0)
+    fprintf(stderr, ", IPC %.2f",
+            r->counters[PERF_INSTRUCTIONS] / r->counters[PERF_CYCLES]);
+  if (printed) fprintf(stderr, "\n");
+}
+
+/* Read the results of a previous run written by write_result() */
+static size_t read_baseline(const char *path, struct bench_result **results) {
+  FILE *in = fopen(path, "r");
+  char line[512];
+  size_t count = 0;
+  size_t capacity = 64;
+
+  if (!in) err(1, "Cannot open baseline %s", path);
+
+  *results = malloc(sizeof(**results) * capacity);
+  if (!*results) errx(1, "Out of memory");
+
+  while (fgets(line, sizeof(line), in)) {
+    struct bench_result r;
+
+    if (sscanf(line,
+               " {\"op\": \"%7[^\"]\", \"bytes\": %zu, \"n\": %d, \"t\": %d, "
+               "\"rule\": \"%7[^\"]\", \"mb_per_s\": %lf, "
+               "\"ns_per_byte_share\": %lf, \"allocs\": %ld, "
+               "\"peak_rss_kb\": %ld",
+               r.op, &r.bytes, &r.n, &r.t, r.rule, &r.mb_per_s,
+               &r.ns_per_byte_share, &r.allocs, &r.peak_rss_kb) != 9)
+      continue;
+
+    if (count == capacity) {
+      capacity *= 2;
+      *results = realloc(*results, sizeof(**results) * capacity);
+      if (!*results) errx(1, "Out of memory");
+    }
+    (*results)[count++] = r;
+  }
+
+  fclose(in);
+  return count;
+}
+
+/*
+ * Print how `r` compares with the same configuration in the baseline.
+ * Returns 1 if its throughput dropped by more than `threshold` percent.
+ */
+static int compare_result(const struct bench_result *r,
+                          const struct bench_result *baseline, size_t count,
+                          double threshold) {
+  for (size_t i = 0; i < count; i++) {
+    const struct bench_result *b = &baseline[i];
+
+    if (strcmp(b->op, r->op) || b->bytes != r->bytes || b->n != r->n ||
+        b->t != r->t)
+      continue;
+
+    double change = (r->mb_per_s - b->mb_per_s) / b->mb_per_s * 100.0;
+    int regressed = change < -threshold;
+
+    fprintf(stderr, "%-5s %10zu B n=%3d t=%3d: %10.2f MB/s vs %10.2f (%+.1f%%)%s\n",
+            r->op, r->bytes, r->n, r->t, r->mb_per_s, b->mb_per_s, change,
+            regressed ? "  REGRESSION" : "");
+    return regressed;
+  }
+
+  fprintf(stderr, "%-5s %10zu B n=%3d t=%3d: not in the baseline\n", r->op,
+          r->bytes, r->n, r->t);
+  return 0;
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "usage: %s [-n counts] [-s sizes] [-w warmup] [-r runs] "
+          "[-m budget(MB)] [-a arena] [-F] [-l limit(s)] [-o results.json] [-b baseline.json] "
+          "[-T threshold(%%)]\n"
+          "  counts and sizes are comma separated, sizes take K, M and G\n"
+          "  -a runs the library on an arena of that many bytes\n"
+          "  -F uses the specialised kernels for the shapes that have one\n"
+          "  -l caps the timed runs of one configuration, after the first\n",
+          prog);
+}
+
+int main(int argc, char *argv[]) {
+  size_t counts[64];
+  size_t sizes[64];
+  size_t count_count = sizeof(default_counts) / sizeof(default_counts[0]);
+  size_t size_count = sizeof(default_sizes) / sizeof(default_sizes[0]);
+  const char *output = NULL;
+  const char *baseline_path = NULL;
+  double threshold = 5.0;
+  int opt;
+
+  memcpy(counts, default_counts, sizeof(default_counts));
+  memcpy(sizes, default_sizes, sizeof(default_sizes));
+
+  while ((opt = getopt(argc, argv, "n:s:w:r:m:a:Fl:o:b:T:")) != -1) {
+    switch (opt) {
+      case 'n':
+        count_count = parse_list(optarg, counts, 64);
+        break;
+      case 's':
+        size_count = parse_list(optarg, sizes, 64);
+        break;
+      case 'w':
+        warmup_runs = atoi(optarg);
+        break;
+      case 'r':
+        timed_runs = atoi(optarg);
+        break;
+      case 'm':
+        memory_budget = parse_size(optarg) * 1000000;
+        break;
+      case 'a':
+        arena_buffer = malloc(parse_size(optarg));
+        if (!arena_buffer) errx(1, "Out of memory");
+        shamir_arena_init(&arena, arena_buffer, parse_size(optarg));
+        break;
+      case 'F':
+#ifndef DEXO_SSS_FIXED
+        errx(1, "Built without the specialised kernels (DEXO_SSS_FIXED)");
+#endif
+        use_fixed = 1;
+        break;
+      case 'l':
+        time_budget_ns = atof(optarg) * 1e9;
+        break;
+      case 'o':
+        output = optarg;
+        break;
+      case 'b':
+        baseline_path = optarg;
+        break;
+      case 'T':
+        threshold = atof(optarg);
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
+  if (timed_runs < 1) errx(1, "At least one timed run is needed");
+
+  for (size_t i = 0; i < count_count; i++)
+    if (counts[i] < 1 || counts[i] > 255)
+      errx(1, "The number of shares must be 1 - 255");
+
+  for (size_t i = 0; i < size_count; i++)
+    if (sizes[i] < 1) errx(1, "Secrets must be at least 1 byte");
+
+  struct bench_result *baseline = NULL;
+  size_t baseline_count = 0;
+  int regressions = 0;
+
+  if (baseline_path) baseline_count = read_baseline(baseline_path, &baseline);
+
+  FILE *out = output ? fopen(output, "w") : stdout;
+  if (!out) err(1, "Cannot write %s", output);
+
+  seed_random();
+
+  if (perf_counters_open() < PERF_COUNTER_COUNT) {
+    fprintf(stderr, "Counters not available (no PMU or perf_event_paranoid):");
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+      if (!perf_counter_available(i))
+        fprintf(stderr, " %s", perf_counter_names[i]);
+    fprintf(stderr, "\n");
+  }
+
+  fprintf(out, "{\"benchmark\": \"dexo_sss\", \"warmup_runs\": %d, "
+               "\"timed_runs\": %d, \"fixed\": %d, \"results\": [",
+          warmup_runs, timed_runs, use_fixed);
+
+  int first = 1;
+
+  for (size_t s = 0; s < size_count; s++) {
+    for (size_t r = 0; r < sizeof(threshold_rules) / sizeof(threshold_rules[0]);
+         r++) {
+      for (size_t i = 0; i < count_count; i++) {
+        int n = counts[i];
+        int t = threshold_rules[r].threshold(n);
+        struct bench_result results[2];
+
+        if (!run_config(sizes[s], n, t, threshold_rules[r].name, &results[0],
+                        &results[1])) {
+          fprintf(stderr, "skip  %10zu B n=%3d t=%3d: over the memory budget\n",
+                  sizes[s], n, t);
+          continue;
+        }
+
+        for (int k = 0; k < 2; k++) {
+          write_result(out, &results[k], first);
+          first = 0;
+
+          if (baseline)
+            regressions +=
+                compare_result(&results[k], baseline, baseline_count, threshold);
+          else
+            fprintf(stderr,
+                    "%-5s %10zu B n=%3d t=%3d: %10.2f MB/s, %8.3f ns/byte/share, "
+                    "%ld allocs (%zu B, peak %zu B), peak RSS %ld kB\n",
+                    results[k].op, results[k].bytes, n, t, results[k].mb_per_s,
+                    results[k].ns_per_byte_share, results[k].allocs,
+                    results[k].alloc_bytes, results[k].peak_bytes,
+                    results[k].peak_rss_kb);
+          print_counters(&results[k]);
+        }
+      }
+    }
+  }
+
+  fprintf(out, "\n]}\n");
+  perf_counters_close();
+
+  if (arena_buffer) {
+    fprintf(stderr, "Arena: high water %zu of %zu B, %zu fallbacks to malloc()\n",
+            arena.high_water, arena.size, arena.fallbacks);
+    shamir_use_arena(NULL);
+    free(arena_buffer);
+  }
+  if (output) fclose(out);
+  free(baseline);
+
+  if (regressions) {
+    fprintf(stderr, "%d result(s) regressed by more than %.1f%%\n", regressions,
+            threshold);
+    return 1;
+  }
+  return 0;
+}
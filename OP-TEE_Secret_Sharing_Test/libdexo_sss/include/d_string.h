@@ -95,6 +95,22 @@ char * d_string_free(
 );
 
 
+/// Free dynamic string but keep its buffer, which now belongs to the caller
+/// (release it with `shamir_free(str, *bufferSize)`)
+char * d_string_take(
+	DString * ripString,                    //!< DString to be freed
+	size_t * bufferSize                     //!< Receives the size of the buffer (may be NULL)
+);
+
+
+/// Make room for `bytes` more bytes, so appending them needs no reallocation.
+/// Returns false if out of memory.
+bool d_string_reserve(
+	DString * baseString,                   //!< DString to be grown
+	size_t bytes                            //!< Number of bytes that will be appended
+);
+
+
 /// Append null-terminated string to end of dynamic string
 void d_string_append(
 	DString * baseString,                   //!< DString to be appended
@@ -117,6 +133,30 @@ void d_string_append_c_array(
 );
 
 
+/// Append bytes (which may include `\0`) to end of dynamic string
+void d_string_append_bytes(
+	DString * baseString,                   //!< DString to be appended
+	const void * appendedBytes,             //!< Bytes to be appended
+	size_t bytes                            //!< Number of bytes to append
+);
+
+
+/// Append bytes to end of dynamic string as upper case hex, two characters per byte
+void d_string_append_hex(
+	DString * baseString,                   //!< DString to be appended
+	const unsigned char * appendedBytes,    //!< Bytes to be encoded
+	size_t bytes                            //!< Number of bytes to encode
+);
+
+
+/// Extend dynamic string by `bytes` bytes and return where they start, for the
+/// caller to fill in.  Returns NULL if out of memory.
+char * d_string_append_space(
+	DString * baseString,                   //!< DString to be appended
+	size_t bytes                            //!< Number of bytes to add
+);
+
+
 /// Append to end of dynamic string using format specifier
 void d_string_append_printf(
 	DString * baseString,                   //!< DString to be appended
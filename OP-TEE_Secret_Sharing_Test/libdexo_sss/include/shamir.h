@@ -0,0 +1,215 @@
+#ifndef SHAMIRS_SECRET_SHARING_H
+#define SHAMIRS_SECRET_SHARING_H
+
+#include <stddef.h>
+
+#include "strtok.h"
+
+#ifdef TEST
+	#include "CuTest.h"
+#endif
+
+/**
+
+@file
+
+@brief Simple library for providing SSS functionality.
+
+
+*/
+
+/// Seed the random number generator.  MUST BE CALLED before using the library (unless on arc4random() system).
+void seed_random(void);
+
+/// Given a secret, `n`, and `t`, create a list of shares (`\n` separated).
+char * generate_share_strings(char * secret, int n, int t);
+
+/// Given a list of shares (`\n` separated without leading whitespace), recreate the original secret.
+char * extract_secret_from_share_strings(const char * string);
+
+/// A share line inside a caller's buffer, see `parse_share_strings()`.
+struct share_view {
+	const char * data;          //!< First character of the share (not NUL-terminated)
+	size_t len;                 //!< Characters in the share, trailing whitespace excluded
+};
+
+/// Find the share lines in `size` bytes of `string` without copying: fills in up to `max` views
+/// (blank lines skipped) and returns the number of lines, which may be more than `max`.
+int parse_share_strings(const char * string, size_t size, struct share_view * views, int max);
+
+/// Given `n` share views, recreate the original secret.
+char * join_share_views(const struct share_view * views, int n);
+
+/// Codec a secret is compressed with before it is split, recorded in characters 4 - 5 of each
+/// share's header.
+enum shamir_codec {
+	SHAMIR_CODEC_NONE,          //!< Stored as it is ('AA')
+	SHAMIR_CODEC_LZ4,           //!< LZ4 block, after the secret's length as 4 bytes little endian ('AB')
+};
+
+/// As `generate_share_strings()`, for `len` bytes of `secret` compressed with `codec` first.  The
+/// secret is stored as it is if it would not get smaller.  Free with `shamir_free(shares, strlen() + 1)`.
+char * generate_share_strings_codec(const char * secret, size_t len, int n, int t, enum shamir_codec codec);
+
+/// As `extract_secret_from_share_strings()` (which also decompresses), for secrets that may hold
+/// zero bytes: the secret's length goes to `len`.
+char * extract_secret_from_share_strings_len(const char * string, size_t * len);
+
+/// Codec recorded in the header of `share`.  Joins return the payload, not the secret.
+int share_codec(const char * share);
+
+/// Record `codec` in the header of `share`.
+void share_set_codec(char * share, enum shamir_codec codec);
+
+/// Bytes `shamir_compress()` may write for a `len` byte secret.
+size_t shamir_compress_bound(size_t len);
+
+/// Compress `len` bytes of `secret` into `out` (`shamir_compress_bound(len)` bytes) for splitting.
+/// Returns the size of the payload, or 0 if it would not be smaller than the secret.
+size_t shamir_compress(enum shamir_codec codec, const char * secret, size_t len, char * out);
+
+/// Size of the secret in a `len` byte payload, `(size_t)-1` if it is malformed or claims more than
+/// the payload could decompress to.
+size_t shamir_decompressed_size(enum shamir_codec codec, const char * payload, size_t len);
+
+/// Decompress a payload into `out`; returns 0 unless it is well formed and gives exactly `size` bytes.
+int shamir_decompress(enum shamir_codec codec, const char * payload, size_t len, char * out, size_t size);
+
+/// Given a secret, `n`, and `t`, create an array of `n` share strings.  Returns NULL when out of memory.
+char ** split_string(char * secret, int n, int t);
+
+/// One secret for `split_many()`.
+struct secret_record {
+	const char * secret;        //!< Secret bytes (need not be NUL-terminated)
+	size_t len;                 //!< Number of bytes in `secret`
+};
+
+/// Split `count` secrets with the same `n` and `t` in one pass.  Returns `n` per-node bundles;
+/// bundle j holds share j + 1 of every record, one `\n` terminated line per record.
+char ** split_many(const struct secret_record * records, int count, int n, int t);
+
+/// Free an array of `n` share strings returned by `split_string()`.
+void free_string_shares(char ** shares, int n);
+
+/// Given `n` share strings, recreate the original secret.
+char * join_strings(char ** shares, int n);
+
+/// Given `n` share strings, recreate only bytes [`offset`, `offset + length`) of the secret.
+/// Only the matching characters of each share are read; every share must cover the range.
+char * join_strings_range(char ** shares, int n, size_t offset, size_t length);
+
+/// As `join_strings_range()`, but into `result` (at least `length` bytes, nothing appended).
+/// Returns 0 if the shares could not be used.
+int join_strings_range_into(char ** shares, int n, size_t offset, size_t length, char * result);
+
+/// Bytes needed for the `n` share lines of a `len` byte secret (no terminating `\0`).
+size_t share_strings_size(size_t len, int n);
+
+/// Split `len` bytes of `secret` and write the `n` share lines (`\n` terminated, the layout of
+/// `generate_share_strings()`) straight into `buffer`, which must hold `share_strings_size(len, n)`
+/// bytes.  Returns 0 on bad arguments or allocation failure.
+int write_share_strings(const char * secret, size_t len, int n, int t, char * buffer);
+
+/// Chunked split of a secret of any size with bounded memory.
+struct split_stream;
+
+/// Start a chunked split into `n` shares with threshold `t`.  Returns NULL on bad arguments.
+struct split_stream * split_stream_new(int n, int t);
+
+/// Write the 6 character header of share `x` (1 - n), without a terminating `\0`.
+void split_stream_header(const struct split_stream * stream, int x, char * out);
+
+/// Split the next `len` bytes of the secret; share j's `2 * len` characters go to `out + j * row_stride`.
+void split_stream_feed(struct split_stream * stream, const char * chunk, size_t len, char * out, size_t row_stride);
+
+/// Finish a chunked split.
+void split_stream_free(struct split_stream * stream);
+
+/// Recreate `records` secrets; `share_sets[r]` holds `counts[r]` share strings for record r.
+/// Records whose shares come from the same nodes are joined with one set of Lagrange weights.
+/// Returns an array of secrets (NULL where a record could not be joined).
+char ** join_many(char *** share_sets, const int * counts, int records);
+
+/// Checks in a share commitment.  Shares that do not lie on one polynomial per byte pass each
+/// with probability at most 2/257.
+#define SHAMIR_VSS_CHECKS 16
+
+/// Characters in the commitment line of `n` shares with threshold `t`, `\n` included.
+size_t share_commitment_size(int n, int t);
+
+/// Commit to all `n` shares of one split, `views[i]` being share i + 1.  Returns the commitment
+/// line to publish to every node, and sets `*proofs` to the `n` proof lines (line i goes to node
+/// i + 1 with its share).  NULL on bad shares.  Free both with `shamir_free(p, strlen(p) + 1)`.
+char * commit_share_views(const struct share_view * views, int n, char ** proofs);
+
+/// Check `count` shares, each with its proof line, against `commitment`; `valid[i]` is set to 1
+/// or 0.  Returns the number of valid shares, or -1 if the commitment is malformed.
+int verify_share_views(const char * commitment, const struct share_view * shares, const struct share_view * proofs, int count, unsigned char * valid);
+
+/// 1 if the first line of `share`, with the first line of `proof`, is valid under `commitment`.
+int verify_share_string(const char * commitment, const char * share, const char * proof);
+
+/// Phases of the split and join paths timed when built with `SHAMIR_PROFILE`.
+enum shamir_phase {
+	SHAMIR_PHASE_RANDOM,        //!< Drawing the polynomial coefficients
+	SHAMIR_PHASE_EVALUATE,      //!< Evaluating the polynomials (split), Lagrange interpolation and decoding (join)
+	SHAMIR_PHASE_ENCODE,        //!< Hex encoding of share values and headers
+	SHAMIR_PHASE_ALLOC,         //!< `malloc()` and `free()` inside the library
+	SHAMIR_PHASE_COUNT
+};
+
+/// Clear the per-phase totals.  A no-op unless built with `SHAMIR_PROFILE`.
+void shamir_profile_reset(void);
+
+/// Microseconds spent in `phase` since the last reset (always 0 unless built with `SHAMIR_PROFILE`).
+unsigned long shamir_profile_us(enum shamir_phase phase);
+
+/// Allocator behind every allocation the library makes, including the results it returns.
+struct shamir_allocator {
+	void *	(*alloc)(size_t size, void * ctx);              //!< As `malloc()`
+	void	(*free)(void * ptr, size_t size, void * ctx);   //!< As `free()`; `size` is what was allocated
+	void *	ctx;                                            //!< Passed to both
+};
+
+/// Allocate through `allocator` from now on (NULL: `malloc()` and `free()`).  Not locked.
+void shamir_set_allocator(const struct shamir_allocator * allocator);
+
+/// Free `size` bytes returned by the library (`length + 1` for a secret, `strlen() + 1` for a
+/// share string) through the current allocator.  With the default allocator `free()` will do.
+void shamir_free(void * ptr, size_t size);
+
+/// Bump allocator over a caller supplied buffer, see `shamir_use_arena()`.
+struct shamir_arena {
+	char *	base;               //!< Start of the buffer
+	size_t	size;               //!< Bytes in the buffer
+	size_t	used;               //!< Bytes handed out and not popped since the last reset
+	size_t	high_water;         //!< Highest `used` since `shamir_arena_init()`
+	size_t	fallbacks;          //!< Allocations that did not fit and went to `malloc()`
+};
+
+/// Set up `arena` over `size` bytes at `buffer`.
+void shamir_arena_init(struct shamir_arena * arena, void * buffer, size_t size);
+
+/// Give back everything allocated from `arena`.  Results still held by the caller become invalid.
+void shamir_arena_reset(struct shamir_arena * arena);
+
+/// Reset `arena` and allocate from it from now on (NULL: back to `malloc()` and `free()`).
+/// Frees of the last allocation give its space back; anything that does not fit goes to `malloc()`.
+void shamir_use_arena(struct shamir_arena * arena);
+
+/// Allocation counters, see `shamir_alloc_stats_reset()`.
+struct shamir_alloc_stats {
+	size_t allocs;              //!< Allocations made
+	size_t frees;               //!< Allocations the library freed
+	size_t bytes;               //!< Bytes allocated
+	size_t live_bytes;          //!< Bytes allocated and not freed yet, results included
+	size_t peak_bytes;          //!< Highest `live_bytes`
+};
+
+/// Clear the allocation counters and start counting (counting is off until the first call).
+void shamir_alloc_stats_reset(void);
+
+/// Read the allocation counters.
+void shamir_alloc_stats_get(struct shamir_alloc_stats * stats);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef SHAMIR_FIXED_H
+#define SHAMIR_FIXED_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+
+@file
+
+@brief C interface to the compile-time specialised kernels of shamir_fixed.hpp.
+
+Compiled in for the committee shapes the benchmarks use -- n = 5, 10, 20, 30,
+40, 50 with t = ceil(2n/3) or ceil(n/2) -- and only in builds with a C++
+compiler (not the TA).  Every call returns -1 for a shape without a
+specialisation, so the caller can fall back to shamir.h.
+
+*/
+
+/// As `write_share_strings()`; -1 if (`n`, `t`) has no specialisation.
+int write_share_strings_fixed(const char * secret, size_t len, int n, int t, char * buffer);
+
+/// As `join_strings_range_into()`; -1 if `n` shares have no specialisation.
+int join_strings_range_into_fixed(char ** shares, int n, size_t offset, size_t length, char * result);
+
+/// Whether (`n`, `t`) has a specialised split.
+int shamir_fixed_supported(int n, int t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,270 @@
+#ifndef SHAMIR_FIXED_HPP
+#define SHAMIR_FIXED_HPP
+
+#include <stddef.h>
+
+#include <utility>
+
+/**
+
+@file
+
+@brief Split and join specialised at compile time for one committee shape.
+
+`fixed_scheme<Field, N, T>` produces and reads the same share lines as
+shamir.h, but with `N` and `T` known to the compiler: the powers of every x
+and the Lagrange weights of the first `T` shares are constexpr tables, and the
+sums over the polynomial's terms and over the shares are unrolled, which leaves
+loops over the bytes of a block that the compiler can vectorise.
+
+Header only; shamir_fixed.h is the C interface.
+
+*/
+
+namespace dexo_sss {
+
+/// GF(257), the field the share format carries.
+struct gf257 {
+	static constexpr unsigned prime = 257;
+};
+
+namespace detail {
+
+constexpr unsigned pow_mod(unsigned base, unsigned exp, unsigned prime) {
+	unsigned result = 1;
+
+	base %= prime;
+
+	while (exp) {
+		if (exp & 1) {
+			result = result * base % prime;
+		}
+
+		base = base * base % prime;
+		exp >>= 1;
+	}
+
+	return result;
+}
+
+/// x^i for x = 1 - N and i = 0 - T-1.
+template <unsigned Prime, int N, int T>
+struct power_table {
+	unsigned short value[N][T];
+
+	constexpr power_table() : value() {
+		for (int x = 0; x < N; ++x) {
+			for (int i = 0; i < T; ++i) {
+				value[x][i] = pow_mod(x + 1, i, Prime);
+			}
+		}
+	}
+};
+
+/// Lagrange weights at 0 for `T` distinct x values; false if they are not distinct or in range.
+template <unsigned Prime, int T>
+constexpr bool lagrange_weights(const int * x, unsigned short * weight) {
+	for (int i = 0; i < T; ++i) {
+		unsigned numerator = 1;
+		unsigned denominator = 1;
+
+		if ((x[i] < 1) || (x[i] >= (int)Prime)) {
+			return false;
+		}
+
+		for (int j = 0; j < T; ++j) {
+			if (i == j) {
+				continue;
+			}
+
+			if (x[i] == x[j]) {
+				return false;
+			}
+
+			numerator = numerator * x[j] % Prime;
+			denominator = denominator * ((x[j] - x[i] + Prime) % Prime) % Prime;
+		}
+
+		weight[i] = numerator * pow_mod(denominator, Prime - 2, Prime) % Prime;
+	}
+
+	return true;
+}
+
+/// Weights of the shares x = 1 - T, the usual "first T nodes" join.
+template <unsigned Prime, int T>
+struct first_weights {
+	unsigned short value[T];
+
+	constexpr first_weights() : value() {
+		int x[T] = {};
+
+		for (int i = 0; i < T; ++i) {
+			x[i] = i + 1;
+		}
+
+		lagrange_weights<Prime, T>(x, value);
+	}
+};
+
+constexpr char codon_digits[] = "0123456789ABCDEFG";
+
+/// Hex digit values ('G' is 16, so 'G0' decodes to 256).
+struct hex_table {
+	unsigned char value[256];
+
+	constexpr hex_table() : value() {
+		for (int i = 0; i < 17; ++i) {
+			value[(unsigned char)codon_digits[i]] = i;
+		}
+
+		for (int i = 10; i < 17; ++i) {
+			value[(unsigned char)(codon_digits[i] + 'a' - 'A')] = i;
+		}
+	}
+};
+
+constexpr hex_table hex{};
+
+inline unsigned decode_codon(const char * codon) {
+	return hex.value[(unsigned char)codon[0]] * 16 + hex.value[(unsigned char)codon[1]];
+}
+
+inline void write_header(char * out, int x, int t) {
+	out[0] = codon_digits[x >> 4];
+	out[1] = codon_digits[x & 0xF];
+	out[2] = codon_digits[t >> 4];
+	out[3] = codon_digits[t & 0xF];
+	out[4] = 'A';
+	out[5] = 'A';
+}
+
+}  // namespace detail
+
+/// Split and join for `N` shares with threshold `T` over `Field`.
+template <class Field, int N, int T>
+class fixed_scheme {
+	static_assert((1 <= T) && (T <= N) && (N <= 255), "need 1 <= T <= N <= 255");
+
+  public:
+	static constexpr unsigned prime = Field::prime;
+
+	/// Bytes split per block: T - 1 rows of coefficients stay within 4 KB.
+	static constexpr size_t block_size =
+		T > 1 ? (2048 / (T - 1) < 16 ? 16 : 2048 / (T - 1) > 256 ? 256 : 2048 / (T - 1)) : 256;
+
+	/// Bytes taken by the `N` share lines of a `len` byte secret.
+	static constexpr size_t shares_size(size_t len) { return (6 + 2 * len + 1) * N; }
+
+	/// Write the `N` share lines of `len` bytes of `secret` into `buffer` (`shares_size(len)` bytes,
+	/// the layout of write_share_strings()).  `random(coef, count)` must fill `count` coefficients
+	/// uniformly from [0, prime).
+	template <class Random>
+	static void split(const unsigned char * secret, size_t len, char * buffer, Random && random) {
+		const size_t stride = 6 + 2 * len + 1;
+		unsigned short coef[(T > 1 ? T - 1 : 1) * block_size];
+
+		for (int x = 0; x < N; ++x) {
+			detail::write_header(buffer + x * stride, x + 1, T);
+			buffer[x * stride + stride - 1] = '\n';
+		}
+
+		for (size_t start = 0; start < len; start += block_size) {
+			size_t block = len - start < block_size ? len - start : block_size;
+
+			random(coef, block * (T - 1));
+
+			for (int x = 0; x < N; ++x) {
+				encode_row(secret + start, coef, block, powers.value[x],
+				           buffer + x * stride + 6 + 2 * start);
+			}
+		}
+	}
+
+	/// Rebuild bytes [`offset`, `offset + length`) of the secret from `T` share lines into `result`.
+	/// Returns false if the shares' x values are repeated or out of range.
+	static bool join(const char * const * shares, size_t offset, size_t length, unsigned char * result) {
+		unsigned short weight[T];
+		int x[T];
+		bool first = true;
+
+		for (int i = 0; i < T; ++i) {
+			x[i] = detail::decode_codon(shares[i]);
+			first = first && (x[i] == i + 1);
+		}
+
+		if (first) {
+			for (int i = 0; i < T; ++i) {
+				weight[i] = first_t.value[i];
+			}
+		} else if (!detail::lagrange_weights<prime, T>(x, weight)) {
+			return false;
+		}
+
+		const char * codons[T];
+
+		for (int i = 0; i < T; ++i) {
+			codons[i] = shares[i] + 6 + 2 * offset;
+		}
+
+		for (size_t start = 0; start < length; start += join_block_size) {
+			size_t block = length - start < join_block_size ? length - start : join_block_size;
+			unsigned acc[join_block_size] = {};
+
+			combine(codons, weight, start, block, acc, std::make_index_sequence<T>());
+
+			for (size_t k = 0; k < block; ++k) {
+				result[start + k] = acc[k] % prime;
+			}
+		}
+
+		return true;
+	}
+
+  private:
+	static constexpr detail::power_table<prime, N, T> powers{};
+	static constexpr detail::first_weights<prime, T> first_t{};
+
+	/// secret + sum(coef_i * x^(i + 1)), unrolled over the T - 1 terms.  Each term is below
+	/// 257 * 257, so 255 of them fit in 32 bits before the one reduction.
+	template <size_t... I>
+	static unsigned evaluate(const unsigned char * secret, const unsigned short * coef, size_t block,
+	                         const unsigned short * power, size_t k, std::index_sequence<I...>) {
+		return (secret[k] + ... + ((unsigned)coef[I * block + k] * power[I + 1])) % prime;
+	}
+
+	static void encode_row(const unsigned char * secret, const unsigned short * coef, size_t block,
+	                       const unsigned short * power, char * codon) {
+		unsigned acc[block_size];
+
+		for (size_t k = 0; k < block; ++k) {
+			acc[k] = evaluate(secret, coef, block, power, k, std::make_index_sequence<T - 1>());
+		}
+
+		for (size_t k = 0; k < block; ++k) {
+			codon[k * 2] = detail::codon_digits[acc[k] >> 4];
+			codon[k * 2 + 1] = detail::codon_digits[acc[k] & 0xF];
+		}
+	}
+
+	/// Bytes joined per pass; a share at a time over a block keeps the reads sequential.
+	static constexpr size_t join_block_size = 128;
+
+	static void accumulate(const char * codon, unsigned weight, size_t block, unsigned * acc) {
+		for (size_t k = 0; k < block; ++k) {
+			acc[k] += weight * detail::decode_codon(codon + 2 * k);
+		}
+	}
+
+	/// acc += sum(w_i * y_i), unrolled over the T shares.  Terms are at most 256 * 256, so the
+	/// sum of 255 fits in 32 bits.
+	template <size_t... I>
+	static void combine(const char * const * codons, const unsigned short * weight, size_t start,
+	                    size_t block, unsigned * acc, std::index_sequence<I...>) {
+		(accumulate(codons[I] + 2 * start, weight[I], block, acc), ...);
+	}
+};
+
+}  // namespace dexo_sss
+
+#endif
@@ -0,0 +1,102 @@
+"""ctypes binding for libdexo_sss, the Shamir secret sharing library the TA uses.
+
+Build the shared library with CMake (see ../CMakeLists.txt) and point
+DEXO_SSS_LIBRARY at it, or install it where the loader can find it.
+"""
+import ctypes
+import ctypes.util
+import os
+
+
+class _ShareView(ctypes.Structure):
+    _fields_ = [('data', ctypes.c_char_p), ('len', ctypes.c_size_t)]
+
+
+def _load():
+    path = os.environ.get('DEXO_SSS_LIBRARY') or ctypes.util.find_library('dexo_sss')
+    if path is None:
+        raise OSError('libdexo_sss not found, set DEXO_SSS_LIBRARY')
+
+    lib = ctypes.CDLL(path)
+
+    lib.share_strings_size.argtypes = [ctypes.c_size_t, ctypes.c_int]
+    lib.share_strings_size.restype = ctypes.c_size_t
+    lib.write_share_strings.argtypes = [ctypes.c_char_p, ctypes.c_size_t, ctypes.c_int,
+                                        ctypes.c_int, ctypes.c_char_p]
+    lib.write_share_strings.restype = ctypes.c_int
+    lib.join_strings_range_into.argtypes = [ctypes.POINTER(ctypes.c_char_p), ctypes.c_int,
+                                            ctypes.c_size_t, ctypes.c_size_t, ctypes.c_char_p]
+    lib.join_strings_range_into.restype = ctypes.c_int
+    lib.commit_share_views.argtypes = [ctypes.POINTER(_ShareView), ctypes.c_int,
+                                       ctypes.POINTER(ctypes.c_void_p)]
+    lib.commit_share_views.restype = ctypes.c_void_p
+    lib.verify_share_string.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p]
+    lib.verify_share_string.restype = ctypes.c_int
+    lib.shamir_free.argtypes = [ctypes.c_void_p, ctypes.c_size_t]
+    lib.shamir_free.restype = None
+
+    # Only matters for builds without getrandom() or arc4random()
+    lib.seed_random()
+    return lib
+
+
+_lib = _load()
+
+
+def split(secret, n, t):
+    """Split `secret` (bytes) into `n` share strings, any `t` of which recreate it."""
+    size = _lib.share_strings_size(len(secret), n)
+    buffer = ctypes.create_string_buffer(size)
+
+    if not _lib.write_share_strings(secret, len(secret), n, t, buffer):
+        raise ValueError('cannot split with n=%d t=%d' % (n, t))
+
+    return buffer.raw.decode('ascii').split('\n')[:n]
+
+
+def join(shares):
+    """Recreate the secret (bytes) from a list of share strings."""
+    if not shares:
+        raise ValueError('no shares given')
+
+    length = (len(shares[0]) - 6) // 2
+    if length < 0 or any(len(share) != len(shares[0]) for share in shares):
+        raise ValueError('shares have different lengths')
+
+    array = (ctypes.c_char_p * len(shares))(*[share.encode('ascii') for share in shares])
+    result = ctypes.create_string_buffer(max(length, 1))
+
+    if not _lib.join_strings_range_into(array, len(shares), 0, length, result):
+        raise ValueError('shares cannot be joined')
+
+    return result.raw[:length]
+
+
+def _take_string(pointer):
+    """Copy a string the library returned and free it."""
+    value = ctypes.string_at(pointer)
+    _lib.shamir_free(pointer, len(value) + 1)
+    return value.decode('ascii')
+
+
+def commit(shares):
+    """Commit to all the share strings of one split, share 1 first.
+
+    Returns the commitment line, which every node must see the same copy of,
+    and one proof line per share, to go to the node with that share.
+    """
+    encoded = [share.encode('ascii') for share in shares]
+    views = (_ShareView * len(encoded))(*[_ShareView(share, len(share)) for share in encoded])
+    proofs = ctypes.c_void_p()
+
+    commitment = _lib.commit_share_views(views, len(encoded), ctypes.byref(proofs))
+    if not commitment:
+        raise ValueError('not all the shares of one split, in order')
+
+    return _take_string(commitment).rstrip('\n'), _take_string(proofs.value).split('\n')[:len(shares)]
+
+
+def verify(commitment, share, proof):
+    """True if `share` and its `proof` line are valid under `commitment`."""
+    return bool(_lib.verify_share_string(commitment.encode('ascii'), share.encode('ascii'),
+                                         proof.encode('ascii')))
@@ -64,60 +64,31 @@
 #include <stdarg.h>
 
 #include "d_string.h"
+#include "shamir.h"
+#include "shamir_private.h"
 
 #ifdef TEST
 	#include "CuTest.h"
 #endif
 
 
-/*
- * The following section came from:
- *
- *	http://lists-archives.org/mingw-users/12649-asprintf-missing-vsnprintf-
- *		behaving-differently-and-_vsncprintf-undefined.html
- *
- * and
- *
- *	http://groups.google.com/group/jansson-users/browse_thread/thread/
- *		76a88d63d9519978/041a7d0570de2d48?lnk=raot
- */
-
-// Some operating systems do not supply vasprintf() -- standardize on this
-// replacement from:
-//		https://github.com/esp8266/Arduino/issues/1954
-int vasprintf(char ** strp, const char * fmt, va_list ap) {
-	va_list ap2;
-	va_copy(ap2, ap);
-
-#if (defined(_WIN32) || defined(__WIN32__))
-	char * tmp = NULL;
-	int size = vsnprintf(tmp, 0, fmt, ap2);
-#else
-	char tmp[1];
-	int size = vsnprintf(tmp, 1, fmt, ap2);
-#endif
-
-	if (size <= 0) {
-		return size;
-	}
-
-	va_end(ap2);
-	size += 1;
-	*strp = (char *)malloc(size * sizeof(char));
-	return vsnprintf(*strp, size, fmt, ap);
-}
-
-
 /* DString */
 
-#define kStringBufferStartingSize 1024					//!< Default size of string buffer capacity
-#define kStringBufferGrowthMultiplier 2					//!< Multiply capacity by this factor when more space is needed
+#define kStringBufferMinimumSize 16						//!< Smallest capacity a string grows to
 #define kStringBufferMaxIncrement 1024 * 1024 * 100		//!< Maximum growth increment when resizing (to limit exponential growth)
 
 
+/*
+ * Memory comes from libdexo_sss's allocator (`shamir_set_allocator()`), so a
+ * DString built by the library can be handed to its caller and released with
+ * `shamir_free()`.  Frees there are sized, which is why `d_string_take()`
+ * reports the size of the buffer it gives away.
+ */
+
+
 /// Create a new dynamic string
 DString * d_string_new(const char * startingString) {
-	DString * newString = malloc(sizeof(DString));
+	DString * newString = shamir_alloc(sizeof(DString));
 
 	if (!newString) {
 		return NULL;
@@ -127,23 +98,19 @@ DString * d_string_new(const char * startingString) {
 		startingString = "";
 	}
 
-	size_t startingBufferSize = kStringBufferStartingSize;
+	/* Exactly what is needed -- d_string_reserve() is the way to presize */
 	size_t startingStringSize = strlen(startingString);
+	size_t startingBufferSize = startingStringSize + 1;
 
-	while (startingBufferSize < (startingStringSize + 1)) {
-		startingBufferSize *= kStringBufferGrowthMultiplier;
-	}
-
-	newString->str = malloc(startingBufferSize);
+	newString->str = shamir_alloc(startingBufferSize);
 
 	if (!newString->str) {
-		free(newString);
+		shamir_free(newString, sizeof(DString));
 		return NULL;
 	}
 
 	newString->currentStringBufferSize = startingBufferSize;
-	strncpy(newString->str, startingString, startingStringSize);
-	newString->str[startingStringSize] = '\0';
+	memcpy(newString->str, startingString, startingBufferSize);
 	newString->currentStringLength = startingStringSize;
 
 	return newString;
@@ -157,7 +124,7 @@ void Test_d_string_new(CuTest * tc) {
 	DString * result = d_string_new(test);
 
 	CuAssertIntEquals(tc, 3, result->currentStringLength);
-	CuAssertIntEquals(tc, kStringBufferStartingSize, result->currentStringBufferSize);
+	CuAssertIntEquals(tc, 4, result->currentStringBufferSize);
 	CuAssertStrEquals(tc, test, result->str);
 	CuAssertIntEquals(tc, '\0', result->str[strlen(test)]);
 
@@ -166,7 +133,7 @@ void Test_d_string_new(CuTest * tc) {
 	result = d_string_new(NULL);
 
 	CuAssertIntEquals(tc, 0, result->currentStringLength);
-	CuAssertIntEquals(tc, kStringBufferStartingSize, result->currentStringBufferSize);
+	CuAssertIntEquals(tc, 1, result->currentStringBufferSize);
 	CuAssertStrEquals(tc, "", result->str);
 	CuAssertIntEquals(tc, '\0', 0);
 
@@ -185,48 +152,98 @@ char * d_string_free(DString * ripString, bool freeCharacterData) {
 
 	if (freeCharacterData) {
 		if (ripString->str != NULL) {
-			free(ripString->str);
+			shamir_free(ripString->str, ripString->currentStringBufferSize);
 		}
 
 		returnedString = NULL;
 	}
 
-	free(ripString);
+	shamir_free(ripString, sizeof(DString));
 
 	return returnedString;
 }
 
 
-/// Ensure that dynamic string has specified capacity
-static void ensureStringBufferCanHold(DString * baseString, size_t newStringSize) {
+/// Free dynamic string, keeping its buffer
+char * d_string_take(DString * ripString, size_t * bufferSize) {
+	if (ripString == NULL) {
+		return NULL;
+	}
+
+	if (bufferSize) {
+		*bufferSize = ripString->currentStringBufferSize;
+	}
+
+	return d_string_free(ripString, false);
+}
+
+
+#ifdef TEST
+void Test_d_string_take(CuTest * tc) {
+	DString * result = d_string_new("foo");
+	size_t size = 0;
+
+	d_string_reserve(result, 60);
+
+	char * test = d_string_take(result, &size);
+	CuAssertStrEquals(tc, "foo", test);
+	CuAssertIntEquals(tc, 64, size);
+	shamir_free(test, size);
+
+	CuAssertPtrEquals(tc, NULL, d_string_take(NULL, &size));
+}
+#endif
+
+
+/// Move dynamic string to a buffer of `newBufferSize` bytes
+static bool resizeStringBuffer(DString * baseString, size_t newBufferSize) {
+	char * temp = shamir_alloc(newBufferSize);
+
+	if (temp == NULL) {
+		/* Out of memory -- the string is left as it was */
+		return false;
+	}
+
+	memcpy(temp, baseString->str, baseString->currentStringLength + 1);
+	shamir_free(baseString->str, baseString->currentStringBufferSize);
+
+	baseString->str = temp;
+	baseString->currentStringBufferSize = newBufferSize;
+
+	return true;
+}
+
+
+/// Ensure that dynamic string has specified capacity, growing by half again (or to
+/// exactly what is needed, if that is more) so repeated appends stay linear
+static bool ensureStringBufferCanHold(DString * baseString, size_t newStringSize) {
 	if (baseString) {
 		size_t newBufferSizeNeeded = newStringSize + 1;
 
 		if (newBufferSizeNeeded > baseString->currentStringBufferSize) {
-			size_t newBufferSize = baseString->currentStringBufferSize;
-
-			while (newBufferSizeNeeded > newBufferSize) {
-				if (newBufferSize > kStringBufferMaxIncrement) {
-					newBufferSize += kStringBufferMaxIncrement;
-				} else {
-					newBufferSize *= kStringBufferGrowthMultiplier;
-				}
+			size_t increment = baseString->currentStringBufferSize / 2;
+
+			if (increment > kStringBufferMaxIncrement) {
+				increment = kStringBufferMaxIncrement;
 			}
 
-			char * temp;
-			temp = realloc(baseString->str, newBufferSize);
+			size_t newBufferSize = baseString->currentStringBufferSize + increment;
 
-			if (temp == NULL) {
-				/* realloc failed */
-				fprintf(stderr, "Error reallocating memory for d_string. Current buffer size %lu.\n", baseString->currentStringBufferSize);
+			if (newBufferSize < kStringBufferMinimumSize) {
+				newBufferSize = kStringBufferMinimumSize;
+			}
 
-				exit(1);
+			if (newBufferSize < newBufferSizeNeeded) {
+				newBufferSize = newBufferSizeNeeded;
 			}
 
-			baseString->str = temp;
-			baseString->currentStringBufferSize = newBufferSize;
+			return resizeStringBuffer(baseString, newBufferSize);
 		}
+
+		return true;
 	}
+
+	return false;
 }
 
 
@@ -236,21 +253,24 @@ void Test_ensureStringBufferCanHold(CuTest * tc) {
 
 	DString * result = d_string_new(test);
 
+	/* Small strings grow to the minimum first */
+	ensureStringBufferCanHold(result, 4);
+	CuAssertIntEquals(tc, kStringBufferMinimumSize, result->currentStringBufferSize);
+
 	ensureStringBufferCanHold(result, 1024);
-	CuAssertIntEquals(tc, 2048, result->currentStringBufferSize);
+	CuAssertIntEquals(tc, 1025, result->currentStringBufferSize);
 
 	ensureStringBufferCanHold(result, 1024);
-	CuAssertIntEquals(tc, 2048, result->currentStringBufferSize);
+	CuAssertIntEquals(tc, 1025, result->currentStringBufferSize);
 
 	/* This becomes 0 after we add 1 for the '\0' */
 	ensureStringBufferCanHold(result, -1);
-	CuAssertIntEquals(tc, 2048, result->currentStringBufferSize);
-
-	ensureStringBufferCanHold(result, 1024 * 1024 - 1);
-	CuAssertIntEquals(tc, 1024 * 1024, result->currentStringBufferSize);
+	CuAssertIntEquals(tc, 1025, result->currentStringBufferSize);
 
-	ensureStringBufferCanHold(result, 1024 * 1024 - 1);
-	CuAssertIntEquals(tc, 1024 * 1024, result->currentStringBufferSize);
+	/* Half again when that is more than is needed */
+	ensureStringBufferCanHold(result, 1100);
+	CuAssertIntEquals(tc, 1537, result->currentStringBufferSize);
+	CuAssertStrEquals(tc, "foo", result->str);
 
 	ensureStringBufferCanHold(NULL, 1024);
 
@@ -259,23 +279,150 @@ void Test_ensureStringBufferCanHold(CuTest * tc) {
 #endif
 
 
-/// Append null-terminated string to end of dynamic string
-void d_string_append(DString * baseString, const char * appendedString) {
-	if (baseString && appendedString) {
-		size_t appendedStringLength = strlen(appendedString);
+/// Make room for `bytes` more bytes
+bool d_string_reserve(DString * baseString, size_t bytes) {
+	if (baseString) {
+		size_t newBufferSizeNeeded = baseString->currentStringLength + bytes + 1;
+
+		if (newBufferSizeNeeded > baseString->currentStringBufferSize) {
+			/* Exactly -- the caller knows how much is coming */
+			return resizeStringBuffer(baseString, newBufferSizeNeeded);
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+
+#ifdef TEST
+void Test_d_string_reserve(CuTest * tc) {
+	DString * result = d_string_new("foo");
+
+	CuAssertIntEquals(tc, true, d_string_reserve(result, 100));
+	CuAssertIntEquals(tc, 104, result->currentStringBufferSize);
+	CuAssertStrEquals(tc, "foo", result->str);
+
+	/* Already there */
+	CuAssertIntEquals(tc, true, d_string_reserve(result, 10));
+	CuAssertIntEquals(tc, 104, result->currentStringBufferSize);
 
-		if (appendedStringLength > 0) {
-			size_t newStringLength = baseString->currentStringLength + appendedStringLength;
-			ensureStringBufferCanHold(baseString, newStringLength);
+	CuAssertIntEquals(tc, false, d_string_reserve(NULL, 10));
 
-			/* We already know where the current string ends, so pass that as the starting address for strncat */
-			strncat(baseString->str + baseString->currentStringLength, appendedString, appendedStringLength);
+	d_string_free(result, true);
+}
+#endif
+
+
+/// Append bytes to end of dynamic string
+void d_string_append_bytes(DString * baseString, const void * appendedBytes, size_t bytes) {
+	if (baseString && appendedBytes && (bytes > 0)) {
+		size_t newStringLength = baseString->currentStringLength + bytes;
+
+		if (ensureStringBufferCanHold(baseString, newStringLength)) {
+			memcpy(baseString->str + baseString->currentStringLength, appendedBytes, bytes);
 			baseString->currentStringLength = newStringLength;
+			baseString->str[newStringLength] = '\0';
 		}
 	}
 }
 
 
+#ifdef TEST
+void Test_d_string_append_bytes(CuTest * tc) {
+	DString * result = d_string_new("foo");
+
+	d_string_append_bytes(result, "ba\0r", 4);
+	CuAssertIntEquals(tc, 7, result->currentStringLength);
+	CuAssertIntEquals(tc, 0, memcmp(result->str, "fooba\0r", 8));
+
+	d_string_append_bytes(result, NULL, 3);
+	CuAssertIntEquals(tc, 7, result->currentStringLength);
+
+	d_string_append_bytes(NULL, "foo", 3);
+
+	d_string_free(result, true);
+}
+#endif
+
+
+/// Append bytes to end of dynamic string as upper case hex
+void d_string_append_hex(DString * baseString, const unsigned char * appendedBytes, size_t bytes) {
+	static const char digits[] = "0123456789ABCDEF";
+
+	char * out = (appendedBytes != NULL) ? d_string_append_space(baseString, bytes * 2) : NULL;
+
+	if (out) {
+		for (size_t i = 0; i < bytes; ++i) {
+			out[i * 2] = digits[appendedBytes[i] >> 4];
+			out[i * 2 + 1] = digits[appendedBytes[i] & 0xF];
+		}
+	}
+}
+
+
+#ifdef TEST
+void Test_d_string_append_hex(CuTest * tc) {
+	DString * result = d_string_new("0x");
+	const unsigned char bytes[] = {0x01, 0xAB, 0x00, 0xFF};
+
+	d_string_append_hex(result, bytes, sizeof(bytes));
+	CuAssertStrEquals(tc, "0x01AB00FF", result->str);
+	CuAssertIntEquals(tc, 10, result->currentStringLength);
+
+	d_string_append_hex(result, NULL, 2);
+	CuAssertStrEquals(tc, "0x01AB00FF", result->str);
+
+	d_string_free(result, true);
+}
+#endif
+
+
+/// Extend dynamic string by `bytes` bytes for the caller to fill in
+char * d_string_append_space(DString * baseString, size_t bytes) {
+	if (baseString) {
+		size_t newStringLength = baseString->currentStringLength + bytes;
+
+		if (ensureStringBufferCanHold(baseString, newStringLength)) {
+			char * space = baseString->str + baseString->currentStringLength;
+
+			baseString->currentStringLength = newStringLength;
+			baseString->str[newStringLength] = '\0';
+
+			return space;
+		}
+	}
+
+	return NULL;
+}
+
+
+#ifdef TEST
+void Test_d_string_append_space(CuTest * tc) {
+	DString * result = d_string_new("foo");
+
+	char * space = d_string_append_space(result, 3);
+	CuAssertPtrEquals(tc, result->str + 3, space);
+	memcpy(space, "bar", 3);
+	CuAssertStrEquals(tc, "foobar", result->str);
+	CuAssertIntEquals(tc, 6, result->currentStringLength);
+
+	CuAssertPtrEquals(tc, NULL, d_string_append_space(NULL, 3));
+
+	d_string_free(result, true);
+}
+#endif
+
+
+/// Append null-terminated string to end of dynamic string
+void d_string_append(DString * baseString, const char * appendedString) {
+	if (baseString && appendedString) {
+		d_string_append_bytes(baseString, appendedString, strlen(appendedString));
+	}
+}
+
+
 #ifdef TEST
 void Test_d_string_append(CuTest * tc) {
 	char * test = "foo";
@@ -302,11 +449,12 @@ void Test_d_string_append(CuTest * tc) {
 void d_string_append_c(DString * baseString, char appendedCharacter) {
 	if (baseString && appendedCharacter) {
 		size_t newSizeNeeded = baseString->currentStringLength + 1;
-		ensureStringBufferCanHold(baseString, newSizeNeeded);
 
-		baseString->str[baseString->currentStringLength] = appendedCharacter;
-		baseString->currentStringLength++;
-		baseString->str[baseString->currentStringLength] = '\0';
+		if (ensureStringBufferCanHold(baseString, newSizeNeeded)) {
+			baseString->str[baseString->currentStringLength] = appendedCharacter;
+			baseString->currentStringLength++;
+			baseString->str[baseString->currentStringLength] = '\0';
+		}
 	}
 }
 
@@ -339,15 +487,7 @@ void d_string_append_c_array(DString * baseString, const char * appendedChars, s
 			// This is the same as regular append
 			d_string_append(baseString, appendedChars);
 		} else {
-			if (appendedChars) {
-				size_t newSizeNeeded = baseString->currentStringLength + bytes;
-				ensureStringBufferCanHold(baseString, newSizeNeeded);
-
-				memcpy((void *)baseString->str + baseString->currentStringLength, appendedChars, bytes);
-
-				baseString->currentStringLength = newSizeNeeded;
-				baseString->str[newSizeNeeded] = '\0';
-			}
+			d_string_append_bytes(baseString, appendedChars, bytes);
 		}
 	}
 }
@@ -382,19 +522,41 @@ void Test_d_string_append_c_array(CuTest * tc) {
 #endif
 
 
+/// Format straight into the spare capacity; only output that does not fit is formatted twice
+static void appendVprintf(DString * baseString, const char * format, va_list args) {
+	size_t length = baseString->currentStringLength;
+	size_t room = baseString->currentStringBufferSize - length;
+	va_list retry;
+
+	va_copy(retry, args);
+
+	int formattedLength = vsnprintf(baseString->str + length, room, format, args);
+
+	if ((formattedLength >= 0) && ((size_t)formattedLength >= room)) {
+		if (ensureStringBufferCanHold(baseString, length + formattedLength)) {
+			vsnprintf(baseString->str + length, formattedLength + 1, format, retry);
+		} else {
+			formattedLength = -1;
+		}
+	}
+
+	va_end(retry);
+
+	if (formattedLength < 0) {
+		baseString->str[length] = '\0';
+	} else {
+		baseString->currentStringLength = length + formattedLength;
+	}
+}
+
+
 /// Append to end of dynamic string using format specifier
 void d_string_append_printf(DString * baseString, const char * format, ...) {
 	if (baseString && format) {
 		va_list args;
 		va_start(args, format);
 
-		char * formattedString = NULL;
-		vasprintf(&formattedString, format, args);
-
-		if (formattedString != NULL) {
-			d_string_append(baseString, formattedString);
-			free(formattedString);
-		}
+		appendVprintf(baseString, format, args);
 
 		va_end(args);
 	}
@@ -421,6 +583,11 @@ void Test_d_string_append_printf(CuTest * tc) {
 
 	d_string_append_printf(NULL, "foo");
 
+	/* Longer than the spare capacity */
+	d_string_append_printf(result, "%s", "0123456789012345678901234567890123456789");
+	CuAssertStrEquals(tc, "foo5bar70123456789012345678901234567890123456789", result->str);
+	CuAssertIntEquals(tc, 48, result->currentStringLength);
+
 	d_string_free(result, true);
 }
 #endif
@@ -433,10 +600,12 @@ void d_string_prepend(DString * baseString, const char * prependedString) {
 
 		if (prependedStringLength > 0) {
 			size_t newStringLength = baseString->currentStringLength + prependedStringLength;
-			ensureStringBufferCanHold(baseString, newStringLength);
+			if (!ensureStringBufferCanHold(baseString, newStringLength)) {
+				return;
+			}
 
 			memmove(baseString->str + prependedStringLength, baseString->str, baseString->currentStringLength);
-			strncpy(baseString->str, prependedString, prependedStringLength);
+			memcpy(baseString->str, prependedString, prependedStringLength);
 			baseString->currentStringLength = newStringLength;
 			baseString->str[baseString->currentStringLength] = '\0';
 		}
@@ -476,11 +645,13 @@ void d_string_insert(DString * baseString, size_t pos, const char * insertedStri
 			}
 
 			size_t newStringLength = baseString->currentStringLength + insertedStringLength;
-			ensureStringBufferCanHold(baseString, newStringLength);
+			if (!ensureStringBufferCanHold(baseString, newStringLength)) {
+				return;
+			}
 
 			/* Shift following string to 'right' */
 			memmove(baseString->str + pos + insertedStringLength, baseString->str + pos, baseString->currentStringLength - pos);
-			strncpy(baseString->str + pos, insertedString, insertedStringLength);
+			memcpy(baseString->str + pos, insertedString, insertedStringLength);
 			baseString->currentStringLength = newStringLength;
 			baseString->str[baseString->currentStringLength] = '\0';
 		}
@@ -521,7 +692,10 @@ void d_string_insert_c(DString * baseString, size_t pos, char insertedCharacter)
 		}
 
 		size_t newSizeNeeded = baseString->currentStringLength + 1;
-		ensureStringBufferCanHold(baseString, newSizeNeeded);
+
+		if (!ensureStringBufferCanHold(baseString, newSizeNeeded)) {
+			return;
+		}
 
 		/* Shift following string to 'right' */
 		memmove(baseString->str + pos + 1, baseString->str + pos, baseString->currentStringLength - pos);
@@ -561,18 +735,19 @@ void Test_d_string_insert_c(CuTest * tc) {
 /// Insert inside dynamic string using format specifier
 void d_string_insert_printf(DString * baseString, size_t pos, const char * format, ...) {
 	if (baseString && format) {
-		va_list args;
-		va_start(args, format);
-
-		char * formattedString = NULL;
-		vasprintf(&formattedString, format, args);
+		DString * formattedString = d_string_new(NULL);
 
 		if (formattedString != NULL) {
-			d_string_insert(baseString, pos, formattedString);
-			free(formattedString);
-		}
+			va_list args;
+			va_start(args, format);
 
-		va_end(args);
+			appendVprintf(formattedString, format, args);
+
+			va_end(args);
+
+			d_string_insert(baseString, pos, formattedString->str);
+			d_string_free(formattedString, true);
+		}
 	}
 }
 
@@ -660,14 +835,17 @@ char * d_string_copy_substring(DString * d, size_t start, size_t len) {
 		}
 
 		if (start + len > d->currentStringLength) {
-			fprintf(stderr, "d_string: Asked to copy invalid substring range.\n");
-			fprintf(stderr, "start: %lu  len: %lu  string: %lu\n", start, len,
-					d->currentStringLength);
+			/* Asked to copy invalid substring range */
+			return NULL;
+		}
+
+		result = shamir_alloc(len + 1);
+
+		if (result == NULL) {
 			return NULL;
 		}
 
-		result = malloc(len + 1);
-		strncpy(result, &d->str[start], len);
+		memcpy(result, &d->str[start], len);
 		result[len] = '\0';
 
 		return result;
@@ -729,6 +907,11 @@ long d_string_replace_text_in_range(DString * d, size_t pos, size_t len, const c
 			}
 		}
 
+		if (pos > d->currentStringLength) {
+			/* Nothing there to search */
+			return 0;
+		}
+
 		char * match = strstr(&(d->str[pos]), original);
 
 		while (match && (match - d->str < stop)) {
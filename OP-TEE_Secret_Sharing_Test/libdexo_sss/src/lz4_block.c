@@ -0,0 +1,283 @@
+/*
+
+        lz4_block.c -- LZ4 block format, compressor and decompressor
+
+        A block is a run of sequences, each a token byte (literal length in the
+        high nibble, match length - 4 in the low one, 15 meaning more length
+        bytes follow), the literals, and a 2 byte little endian offset back to
+        the match.  The last sequence has literals only.  Blocks written here
+        follow the format's end rules (the last 5 bytes are literals, no match
+        starts in the last 12), so any LZ4 decoder reads them.
+
+        The compressor is the greedy single-probe one: hash the next 4 bytes,
+        look up the last position with the same hash, and take the match if
+        the bytes agree.  That is where most of LZ4's ratio on text and records
+        comes from, at a fraction of the code of the reference implementation.
+
+        The decompressor checks every length and offset against both buffers,
+        as its input is rebuilt from shares and may be corrupt.
+
+*/
+
+#include "lz4_block.h"
+
+#include <string.h>
+
+#ifdef TEST
+  #include <stdlib.h>
+
+  #include "CuTest.h"
+#endif
+
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MFLIMIT 12
+#define LZ4_MAX_OFFSET 65535
+
+size_t lz4_compress_bound(size_t len) { return len + len / 255 + 16; }
+
+static uint32_t read32(const unsigned char *p) {
+  uint32_t value;
+
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static uint32_t lz4_hash(uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - LZ4_HASH_LOG);
+}
+
+/* Write `length` as the continuation bytes of a token nibble of 15 */
+static unsigned char *write_length(unsigned char *out, size_t length) {
+  while (length >= 255) {
+    *out++ = 255;
+    length -= 255;
+  }
+
+  *out++ = (unsigned char)length;
+  return out;
+}
+
+/*
+        emit_sequence() -- append `literal_len` literals and a match of
+                `match_len` bytes (0: none, the last sequence) at `offset`
+
+        Returns the new end of the output, or NULL if it would pass `end`.
+*/
+
+static unsigned char *emit_sequence(unsigned char *out, unsigned char *end,
+                                    const unsigned char *literals,
+                                    size_t literal_len, size_t offset,
+                                    size_t match_len) {
+  size_t match_code = match_len ? match_len - LZ4_MIN_MATCH : 0;
+  size_t need = 1 + literal_len + literal_len / 255 + 1 + 2 + match_code / 255 + 1;
+
+  if ((size_t)(end - out) < need) {
+    return NULL;
+  }
+
+  unsigned char *token = out++;
+
+  *token = (unsigned char)((literal_len >= 15 ? 15 : literal_len) << 4);
+
+  if (literal_len >= 15) {
+    out = write_length(out, literal_len - 15);
+  }
+
+  memcpy(out, literals, literal_len);
+  out += literal_len;
+
+  if (match_len) {
+    *out++ = (unsigned char)(offset & 0xFF);
+    *out++ = (unsigned char)(offset >> 8);
+
+    *token |= (unsigned char)(match_code >= 15 ? 15 : match_code);
+
+    if (match_code >= 15) {
+      out = write_length(out, match_code - 15);
+    }
+  }
+
+  return out;
+}
+
+size_t lz4_compress(const unsigned char *src, size_t len, unsigned char *dst,
+                    size_t capacity, uint32_t *table) {
+  unsigned char *out = dst;
+  unsigned char *end = dst + capacity;
+  size_t anchor = 0;  // Start of the literals not yet written
+  size_t i = 0;
+
+  /* Shorter inputs can only be literals */
+  if (len > LZ4_MFLIMIT) {
+    size_t match_limit = len - LZ4_LAST_LITERALS;
+
+    memset(table, 0, sizeof(uint32_t) * LZ4_HASH_SIZE);
+
+    while (i < len - LZ4_MFLIMIT) {
+      uint32_t sequence = read32(src + i);
+      uint32_t h = lz4_hash(sequence);
+      size_t candidate = table[h];
+
+      table[h] = (uint32_t)i;
+
+      /* An empty slot reads as position 0, which the byte check sorts out */
+      if ((candidate < i) && (i - candidate <= LZ4_MAX_OFFSET) &&
+          (read32(src + candidate) == sequence)) {
+        size_t match_len = LZ4_MIN_MATCH;
+
+        while ((i + match_len < match_limit) &&
+               (src[candidate + match_len] == src[i + match_len])) {
+          ++match_len;
+        }
+
+        out = emit_sequence(out, end, src + anchor, i - anchor, i - candidate,
+                            match_len);
+
+        if (out == NULL) {
+          return 0;
+        }
+
+        i += match_len;
+        anchor = i;
+        continue;
+      }
+
+      ++i;
+    }
+  }
+
+  out = emit_sequence(out, end, src + anchor, len - anchor, 0, 0);
+
+  return out ? (size_t)(out - dst) : 0;
+}
+
+/* Read the continuation bytes of a length nibble of 15 into *length */
+static int read_length(const unsigned char **in, const unsigned char *end,
+                       size_t *length) {
+  unsigned char byte;
+
+  do {
+    if (*in >= end) {
+      return 0;
+    }
+
+    byte = *(*in)++;
+    *length += byte;
+  } while (byte == 255);
+
+  return 1;
+}
+
+size_t lz4_decompress(const unsigned char *src, size_t len, unsigned char *dst,
+                      size_t capacity) {
+  const unsigned char *in = src;
+  const unsigned char *in_end = src + len;
+  size_t out = 0;
+
+  while (in < in_end) {
+    unsigned char token = *in++;
+    size_t literal_len = token >> 4;
+
+    if ((literal_len == 15) && !read_length(&in, in_end, &literal_len)) {
+      return (size_t)-1;
+    }
+
+    if ((literal_len > (size_t)(in_end - in)) || (literal_len > capacity - out)) {
+      return (size_t)-1;
+    }
+
+    memcpy(dst + out, in, literal_len);
+    in += literal_len;
+    out += literal_len;
+
+    /* The last sequence ends with its literals */
+    if (in == in_end) {
+      break;
+    }
+
+    if (in_end - in < 2) {
+      return (size_t)-1;
+    }
+
+    size_t offset = in[0] | (in[1] << 8);
+    size_t match_len = token & 0xF;
+
+    in += 2;
+
+    if ((match_len == 15) && !read_length(&in, in_end, &match_len)) {
+      return (size_t)-1;
+    }
+
+    match_len += LZ4_MIN_MATCH;
+
+    if ((offset == 0) || (offset > out) || (match_len > capacity - out)) {
+      return (size_t)-1;
+    }
+
+    /* Byte by byte: the match may overlap what it is copying */
+    const unsigned char *match = dst + out - offset;
+    size_t k;
+
+    for (k = 0; k < match_len; ++k) {
+      dst[out + k] = match[k];
+    }
+
+    out += match_len;
+  }
+
+  return out;
+}
+
+#ifdef TEST
+void Test_lz4_block(CuTest *tc) {
+  static uint32_t table[LZ4_HASH_SIZE];
+  const char *record =
+      "{\"user\": \"alice\", \"role\": \"admin\", \"active\": true}\n"
+      "{\"user\": \"bob\", \"role\": \"admin\", \"active\": true}\n"
+      "{\"user\": \"carol\", \"role\": \"admin\", \"active\": false}\n"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
+  size_t len = strlen(record);
+  unsigned char block[512];
+  unsigned char back[512];
+
+  size_t size = lz4_compress((const unsigned char *)record, len, block,
+                             sizeof(block), table);
+
+  CuAssertTrue(tc, (size > 0) && (size < len));
+  CuAssertIntEquals(tc, (int)len, (int)lz4_decompress(block, size, back, sizeof(back)));
+  CuAssertIntEquals(tc, 0, memcmp(back, record, len));
+
+  /* Does not fit */
+  CuAssertIntEquals(tc, 0, (int)lz4_compress((const unsigned char *)record, len,
+                                             block, 16, table));
+
+  /* Too little room to decompress into, and a block cut short */
+  CuAssertTrue(tc, lz4_decompress(block, size, back, len - 1) == (size_t)-1);
+  CuAssertTrue(tc, lz4_decompress(block, size - 3, back, sizeof(back)) == (size_t)-1);
+
+  /* Short inputs are literals only */
+  size = lz4_compress((const unsigned char *)"abc", 3, block, sizeof(block), table);
+  CuAssertIntEquals(tc, 4, (int)size);
+  CuAssertIntEquals(tc, 3, (int)lz4_decompress(block, size, back, sizeof(back)));
+
+  /* Random bytes round trip too */
+  unsigned char *noise = malloc(70000);
+  unsigned char *packed = malloc(lz4_compress_bound(70000));
+  unsigned char *unpacked = malloc(70000);
+  size_t i;
+
+  for (i = 0; i < 70000; ++i) {
+    noise[i] = (i % 3) ? (unsigned char)rand() : (unsigned char)(i >> 9);
+  }
+
+  size = lz4_compress(noise, 70000, packed, lz4_compress_bound(70000), table);
+  CuAssertTrue(tc, size > 0);
+  CuAssertIntEquals(tc, 70000, (int)lz4_decompress(packed, size, unpacked, 70000));
+  CuAssertIntEquals(tc, 0, memcmp(noise, unpacked, 70000));
+
+  free(unpacked);
+  free(packed);
+  free(noise);
+}
+#endif
@@ -0,0 +1,36 @@
+#ifndef LZ4_BLOCK_H
+#define LZ4_BLOCK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* LZ4 block format codec (no frame), for the compression stage of shamir.c */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Entries in the compressor's hash table, which the caller supplies */
+#define LZ4_HASH_LOG 12
+#define LZ4_HASH_SIZE (1 << LZ4_HASH_LOG)
+
+/* Largest block `len` bytes can compress to */
+size_t lz4_compress_bound(size_t len);
+
+/* Compress `len` bytes of `src` into at most `capacity` bytes of `dst`, using
+   `table` (LZ4_HASH_SIZE entries) as scratch.  Returns the size of the block,
+   or 0 if it does not fit. */
+size_t lz4_compress(const unsigned char *src, size_t len, unsigned char *dst,
+                    size_t capacity, uint32_t *table);
+
+/* Decompress the block of `len` bytes at `src` into at most `capacity` bytes
+   of `dst`.  Returns the bytes written, or (size_t)-1 if the block is
+   malformed or does not fit. */
+size_t lz4_decompress(const unsigned char *src, size_t len, unsigned char *dst,
+                      size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,223 @@
+/*
+
+        sha256.c -- SHA-256 (FIPS 180-4)
+
+        The plain portable implementation: one 64 round compression per 64
+        byte block, with the message schedule kept in a 16 word ring.  It is
+        only used to commit to shares and to derive the challenges of the
+        share checks (see "Share commitments" in shamir.c), so it favours
+        small code and stack over speed.
+
+*/
+
+#include "sha256.h"
+
+#include <string.h>
+
+#ifdef TEST
+  #include "CuTest.h"
+#endif
+
+static const uint32_t round_constants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+static uint32_t load_be32(const unsigned char *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void compress(uint32_t *state, const unsigned char *block) {
+  uint32_t w[16];
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+  uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+  int i;
+
+  for (i = 0; i < 64; ++i) {
+    uint32_t word;
+
+    if (i < 16) {
+      word = load_be32(block + 4 * i);
+    } else {
+      uint32_t w15 = w[(i - 15) & 15];
+      uint32_t w2 = w[(i - 2) & 15];
+
+      word = w[i & 15] + (rotr(w15, 7) ^ rotr(w15, 18) ^ (w15 >> 3)) +
+             w[(i - 7) & 15] + (rotr(w2, 17) ^ rotr(w2, 19) ^ (w2 >> 10));
+    }
+
+    w[i & 15] = word;
+
+    uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) +
+                  ((e & f) ^ (~e & g)) + round_constants[i] + word;
+    uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) +
+                  ((a & b) ^ (a & c) ^ (b & c));
+
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+  state[5] += f;
+  state[6] += g;
+  state[7] += h;
+}
+
+void sha256_init(struct sha256 *ctx) {
+  static const uint32_t initial[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                      0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                      0x1f83d9ab, 0x5be0cd19};
+
+  memcpy(ctx->state, initial, sizeof(initial));
+  ctx->length = 0;
+}
+
+void sha256_update(struct sha256 *ctx, const void *data, size_t len) {
+  const unsigned char *in = data;
+  size_t used = ctx->length % 64;
+
+  ctx->length += len;
+
+  if (used) {
+    size_t take = 64 - used < len ? 64 - used : len;
+
+    memcpy(ctx->block + used, in, take);
+    in += take;
+    len -= take;
+
+    if (used + take < 64) {
+      return;
+    }
+
+    compress(ctx->state, ctx->block);
+  }
+
+  /* Whole blocks straight from the input */
+  while (len >= 64) {
+    compress(ctx->state, in);
+    in += 64;
+    len -= 64;
+  }
+
+  memcpy(ctx->block, in, len);
+}
+
+void sha256_final(struct sha256 *ctx, unsigned char digest[SHA256_DIGEST_SIZE]) {
+  uint64_t bits = ctx->length * 8;
+  size_t used = ctx->length % 64;
+  int i;
+
+  ctx->block[used++] = 0x80;
+
+  /* No room for the length: pad out this block and start another */
+  if (used > 56) {
+    memset(ctx->block + used, 0, 64 - used);
+    compress(ctx->state, ctx->block);
+    used = 0;
+  }
+
+  memset(ctx->block + used, 0, 56 - used);
+
+  for (i = 0; i < 8; ++i) {
+    ctx->block[56 + i] = (unsigned char)(bits >> (56 - 8 * i));
+  }
+
+  compress(ctx->state, ctx->block);
+
+  for (i = 0; i < 8; ++i) {
+    digest[4 * i] = (unsigned char)(ctx->state[i] >> 24);
+    digest[4 * i + 1] = (unsigned char)(ctx->state[i] >> 16);
+    digest[4 * i + 2] = (unsigned char)(ctx->state[i] >> 8);
+    digest[4 * i + 3] = (unsigned char)ctx->state[i];
+  }
+}
+
+void sha256(const void *data, size_t len, unsigned char digest[SHA256_DIGEST_SIZE]) {
+  struct sha256 ctx;
+
+  sha256_init(&ctx);
+  sha256_update(&ctx, data, len);
+  sha256_final(&ctx, digest);
+}
+
+#ifdef TEST
+static void assert_digest(CuTest *tc, const unsigned char *digest, const char *hex) {
+  char out[2 * SHA256_DIGEST_SIZE + 1];
+  int i;
+
+  for (i = 0; i < SHA256_DIGEST_SIZE; ++i) {
+    out[2 * i] = "0123456789abcdef"[digest[i] >> 4];
+    out[2 * i + 1] = "0123456789abcdef"[digest[i] & 0xF];
+  }
+
+  out[2 * SHA256_DIGEST_SIZE] = '\0';
+  CuAssertStrEquals(tc, hex, out);
+}
+
+void Test_sha256(CuTest *tc) {
+  unsigned char digest[SHA256_DIGEST_SIZE];
+  const char *two_blocks =
+      "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+  struct sha256 ctx;
+  size_t i;
+
+  sha256("", 0, digest);
+  assert_digest(tc, digest,
+                "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+
+  sha256("abc", 3, digest);
+  assert_digest(tc, digest,
+                "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+
+  /* 56 bytes: the length goes into a block of its own */
+  sha256(two_blocks, strlen(two_blocks), digest);
+  assert_digest(tc, digest,
+                "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+
+  /* The same fed a byte at a time */
+  sha256_init(&ctx);
+
+  for (i = 0; i < strlen(two_blocks); ++i) {
+    sha256_update(&ctx, two_blocks + i, 1);
+  }
+
+  sha256_final(&ctx, digest);
+  assert_digest(tc, digest,
+                "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+
+  /* A million 'a's, in uneven pieces */
+  char a[1000];
+
+  memset(a, 'a', sizeof(a));
+  sha256_init(&ctx);
+
+  for (i = 0; i < 1000000; i += 999) {
+    sha256_update(&ctx, a, 1000000 - i < 999 ? 1000000 - i : 999);
+  }
+
+  sha256_final(&ctx, digest);
+  assert_digest(tc, digest,
+                "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+#endif
@@ -0,0 +1,35 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* SHA-256 (FIPS 180-4), for the share commitments of shamir.c */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHA256_DIGEST_SIZE 32
+
+struct sha256 {
+  uint32_t state[8];
+  uint64_t length;             // Bytes hashed so far
+  unsigned char block[64];     // Input not yet compressed
+};
+
+void sha256_init(struct sha256 *ctx);
+
+void sha256_update(struct sha256 *ctx, const void *data, size_t len);
+
+/* Write the digest of everything hashed since sha256_init() to `digest` */
+void sha256_final(struct sha256 *ctx, unsigned char digest[SHA256_DIGEST_SIZE]);
+
+/* Digest of `len` bytes of `data` in one call */
+void sha256(const void *data, size_t len, unsigned char digest[SHA256_DIGEST_SIZE]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
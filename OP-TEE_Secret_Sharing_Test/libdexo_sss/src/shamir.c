@@ -0,0 +1,3055 @@
+/*
+
+        shamir.c -- Shamir's Secret Sharing
+
+        Inspired by:
+
+                http://en.wikipedia.org/wiki/Shamir's_Secret_Sharing#Javascript_example
+
+
+        Compatible with:
+
+                http://www.christophedavid.org/w/c/w.php/Calculators/ShamirSecretSharing
+
+        Notes:
+
+                * The secrets start with 'AABBCC'
+                * 'AA' is the hex encoded share # (1 - 255)
+                * 'BB' is the threshold # of shares, also in hex
+                * 'CC' is fake for compatibility with the web implementation
+   above (= 'AA')
+                * Remaining characters are encoded 1 byte = 2 hex characters,
+   plus 'G0' = 256 (since we use 257 prime modulus)
+
+        Limitations:
+
+                * rand() needs to be seeded before use (see below), unless
+                  built with HAVE_GETRANDOM or HAVE_ARC4RANDOM, or for a TA
+
+
+        Copyright © 2015 Fletcher T. Penney. Licensed under the MIT License.
+
+        ## The MIT License ##
+
+        Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+        furnished to do so, subject to the following conditions:
+
+        The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+        THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+        FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+        LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+#include "shamir.h"
+#include "d_string.h"
+#include "lz4_block.h"
+#include "sha256.h"
+#include "shamir_private.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef SHAMIR_TA
+  /* Built into an OP-TEE Trusted Application */
+  #include <tee_internal_api.h>
+#else
+  #include <time.h>
+  #include <unistd.h>
+#endif
+
+#ifdef HAVE_GETRANDOM
+  #include <errno.h>
+  #include <sys/random.h>
+#endif
+
+static int prime = 257;
+
+/*
+        Per-phase profiling
+
+        With SHAMIR_PROFILE defined, the split and join paths add the time
+        spent in each phase to a running total.  The clock is the generic
+        timer's virtual counter with SHAMIR_PROFILE_CNTVCT on AArch64 or
+        ARMv7 (EL0 access to it must be enabled; the TA build turns this on
+        by default), otherwise TEE_GetSystemTime() inside a TA and
+        CLOCK_MONOTONIC elsewhere.  Every reading is taken inside the loops,
+        once per tile and phase, so the totals are only meaningful with a
+        cheap, fine clock: TEE_GetSystemTime() has millisecond resolution, and
+        nearly every interval it measures rounds to 0.
+*/
+
+#ifdef SHAMIR_PROFILE
+static unsigned long long profile_ticks[SHAMIR_PHASE_COUNT];
+
+#if defined(SHAMIR_PROFILE_CNTVCT) && defined(__aarch64__)
+static unsigned long long profile_clock(void) {
+  unsigned long long ticks;
+
+  __asm__ volatile("isb; mrs %0, cntvct_el0" : "=r"(ticks));
+  return ticks;
+}
+
+static unsigned long long profile_frequency(void) {
+  unsigned long long frequency;
+
+  __asm__ volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+  return frequency;
+}
+#elif defined(SHAMIR_PROFILE_CNTVCT) && defined(__arm__) && __ARM_ARCH >= 7
+/* The same counter through the AArch32 CP15 interface (32-bit TAs) */
+static unsigned long long profile_clock(void) {
+  unsigned long long ticks;
+
+  __asm__ volatile("isb; mrrc p15, 1, %Q0, %R0, c14" : "=r"(ticks));
+  return ticks;
+}
+
+static unsigned long long profile_frequency(void) {
+  unsigned int frequency;
+
+  __asm__ volatile("mrc p15, 0, %0, c14, c0, 0" : "=r"(frequency));
+  return frequency;
+}
+#elif defined(SHAMIR_TA)
+static unsigned long long profile_clock(void) {
+  TEE_Time now;
+
+  TEE_GetSystemTime(&now);
+  return (unsigned long long)now.seconds * 1000 + now.millis;
+}
+
+static unsigned long long profile_frequency(void) { return 1000; }
+#else
+static unsigned long long profile_clock(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static unsigned long long profile_frequency(void) { return 1000000000; }
+#endif
+
+#define PROFILE_START(name) unsigned long long name = profile_clock()
+#define PROFILE_STOP(name, phase) \
+  (profile_ticks[phase] += profile_clock() - (name))
+
+void shamir_profile_reset(void) {
+  memset(profile_ticks, 0, sizeof(profile_ticks));
+}
+
+unsigned long shamir_profile_us(enum shamir_phase phase) {
+  return profile_ticks[phase] * 1000000 / profile_frequency();
+}
+#else
+#define PROFILE_START(name)
+#define PROFILE_STOP(name, phase)
+
+void shamir_profile_reset(void) {}
+
+unsigned long shamir_profile_us(enum shamir_phase phase) {
+  (void)phase;
+  return 0;
+}
+#endif
+
+/*
+        Allocation hooks and accounting
+
+        Every allocation the library makes goes through lib_malloc() and
+        lib_free(), which call the allocator set with shamir_set_allocator()
+        -- malloc() and free() by default.  The library always knows how much
+        it allocated, so frees are sized: an allocator needs no headers, and
+        the counters can follow the live bytes.
+
+        Counting starts with the first shamir_alloc_stats_reset().  Results
+        handed to the caller stay live as far as the counters are concerned
+        unless they come back through shamir_free().  Like the Lagrange cache,
+        neither the allocator nor the counters are locked.
+*/
+
+static void *default_alloc(size_t size, void *ctx) {
+  (void)ctx;
+  return malloc(size);
+}
+
+static void default_free(void *ptr, size_t size, void *ctx) {
+  (void)size;
+  (void)ctx;
+  free(ptr);
+}
+
+static struct shamir_allocator allocator = {default_alloc, default_free, NULL};
+static struct shamir_alloc_stats alloc_stats;
+static int alloc_counting = 0;
+
+void shamir_set_allocator(const struct shamir_allocator *hooks) {
+  if (hooks == NULL) {
+    allocator.alloc = default_alloc;
+    allocator.free = default_free;
+    allocator.ctx = NULL;
+  } else {
+    allocator = *hooks;
+  }
+}
+
+void shamir_alloc_stats_reset(void) {
+  memset(&alloc_stats, 0, sizeof(alloc_stats));
+  alloc_counting = 1;
+}
+
+void shamir_alloc_stats_get(struct shamir_alloc_stats *stats) {
+  *stats = alloc_stats;
+}
+
+static void *lib_malloc(size_t size) {
+  void *ptr = allocator.alloc(size, allocator.ctx);
+
+  if (alloc_counting && (ptr != NULL)) {
+    alloc_stats.allocs++;
+    alloc_stats.bytes += size;
+    alloc_stats.live_bytes += size;
+
+    if (alloc_stats.live_bytes > alloc_stats.peak_bytes) {
+      alloc_stats.peak_bytes = alloc_stats.live_bytes;
+    }
+  }
+
+  return ptr;
+}
+
+static void *lib_calloc(size_t count, size_t size) {
+  if ((size != 0) && (count > (size_t)-1 / size)) {
+    return NULL;
+  }
+
+  void *ptr = lib_malloc(count * size);
+
+  if (ptr != NULL) {
+    memset(ptr, 0, count * size);
+  }
+
+  return ptr;
+}
+
+/* Free `ptr`, which was allocated with `size` bytes */
+static void lib_free(void *ptr, size_t size) {
+  if (ptr == NULL) {
+    return;
+  }
+
+  if (alloc_counting) {
+    alloc_stats.frees++;
+    /* Memory allocated before the last reset may be freed after it */
+    alloc_stats.live_bytes -=
+        size < alloc_stats.live_bytes ? size : alloc_stats.live_bytes;
+  }
+
+  allocator.free(ptr, size, allocator.ctx);
+}
+
+void *shamir_alloc(size_t size) { return lib_malloc(size); }
+
+void shamir_free(void *ptr, size_t size) { lib_free(ptr, size); }
+
+/*
+        Arena
+
+        A bump allocator over a buffer the caller owns, reset once per
+        operation, so the split and join paths make no heap calls -- inside
+        a TA malloc() is OP-TEE's bget heap, which is slow and fragments.
+        The library frees in the reverse order it allocates, so a free of the
+        most recent allocation pops it and the arena rarely grows past one
+        operation's working set.  Allocations that do not fit fall back to
+        malloc(), and frees tell the two apart by address.
+*/
+
+#define ARENA_ALIGN 16
+
+static size_t arena_round(size_t size) {
+  return (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+static void *arena_alloc(size_t size, void *ctx) {
+  struct shamir_arena *arena = ctx;
+  size_t rounded = arena_round(size);
+
+  if ((rounded < size) || (rounded > arena->size - arena->used)) {
+    arena->fallbacks++;
+    return malloc(size);
+  }
+
+  void *ptr = arena->base + arena->used;
+
+  arena->used += rounded;
+
+  if (arena->used > arena->high_water) {
+    arena->high_water = arena->used;
+  }
+
+  return ptr;
+}
+
+static void arena_free(void *ptr, size_t size, void *ctx) {
+  struct shamir_arena *arena = ctx;
+  char *p = ptr;
+
+  if ((p < arena->base) || (p >= arena->base + arena->size)) {
+    free(ptr);
+    return;
+  }
+
+  /* Only the most recent allocation can be given back before a reset */
+  if (p + arena_round(size) == arena->base + arena->used) {
+    arena->used -= arena_round(size);
+  }
+}
+
+void shamir_arena_init(struct shamir_arena *arena, void *buffer, size_t size) {
+  /* Start on an aligned address */
+  size_t skip = (ARENA_ALIGN - (size_t)buffer % ARENA_ALIGN) % ARENA_ALIGN;
+
+  arena->base = (char *)buffer + (skip < size ? skip : size);
+  arena->size = skip < size ? size - skip : 0;
+  arena->used = 0;
+  arena->high_water = 0;
+  arena->fallbacks = 0;
+}
+
+void shamir_arena_reset(struct shamir_arena *arena) { arena->used = 0; }
+
+void shamir_use_arena(struct shamir_arena *arena) {
+  if (arena == NULL) {
+    shamir_set_allocator(NULL);
+    return;
+  }
+
+  struct shamir_allocator hooks = {arena_alloc, arena_free, arena};
+
+  shamir_arena_reset(arena);
+  shamir_set_allocator(&hooks);
+}
+
+/*
+        http://stackoverflow.com/questions/322938/recommended-way-to-initialize-srand
+
+        http://www.concentric.net/~Ttwang/tech/inthash.htm
+
+        Need a less predictable way to seed rand().
+*/
+
+unsigned long mix(unsigned long a, unsigned long b, unsigned long c) {
+  a = a - b;
+  a = a - c;
+  a = a ^ (c >> 13);
+  b = b - c;
+  b = b - a;
+  b = b ^ (a << 8);
+  c = c - a;
+  c = c - b;
+  c = c ^ (b >> 13);
+  a = a - b;
+  a = a - c;
+  a = a ^ (c >> 12);
+  b = b - c;
+  b = b - a;
+  b = b ^ (a << 16);
+  c = c - a;
+  c = c - b;
+  c = c ^ (b >> 5);
+  a = a - b;
+  a = a - c;
+  a = a ^ (c >> 3);
+  b = b - c;
+  b = b - a;
+  b = b ^ (a << 10);
+  c = c - a;
+  c = c - b;
+  c = c ^ (b >> 15);
+  return c;
+}
+
+void seed_random(void) {
+#ifndef SHAMIR_TA
+  unsigned long seed = mix(clock(), time(NULL), getpid());
+  srand(seed);
+#endif
+}
+
+/*
+        from
+   http://stackoverflow.com/questions/18730071/c-programming-to-calculate-using-modular-exponentiation
+
+        Allows working with larger numbers (e.g. 255 shares, with a threshold of
+   200)
+*/
+
+int modular_exponentiation(int base, int exp, int mod) {
+  if (exp == 0) {
+    return 1;
+  } else if (exp % 2 == 0) {
+    int mysqrt = modular_exponentiation(base, exp / 2, mod);
+    return (mysqrt * mysqrt) % mod;
+  } else {
+    return (base * modular_exponentiation(base, exp - 1, mod)) % mod;
+  }
+}
+
+/*
+        split_number() -- Split a number into shares
+        n = the number of shares
+        t = threshold shares to recreate the number
+*/
+
+int *split_number(int number, int n, int t) {
+  int *shares = lib_malloc(sizeof(int) * n);
+
+  int *coef = lib_malloc(sizeof(int) * t);
+  int x;
+  int i;
+
+  coef[0] = number;
+
+  for (i = 1; i < t; ++i) {
+    /* Generate random coefficients -- use arc4random if available */
+#ifdef HAVE_ARC4RANDOM
+    coef[i] = arc4random_uniform(prime);
+#else
+    coef[i] = rand() % (prime);
+#endif
+  }
+
+  for (x = 0; x < n; ++x) {
+    int y = coef[0];
+
+    /* Calculate the shares */
+    for (i = 1; i < t; ++i) {
+      int temp = modular_exponentiation(x + 1, i, prime);
+
+      y = (y + (coef[i] * temp % prime)) % prime;
+    }
+
+    /* Sometimes we're getting negative numbers, and need to fix that */
+    y = (y + prime) % prime;
+
+    shares[x] = y;
+  }
+
+  lib_free(coef, sizeof(int) * t);
+
+  return shares;
+}
+
+#ifdef TEST
+void Test_split_number(CuTest *tc) {
+  seed_random();
+
+  int *test = split_number(1234, 50, 20);
+
+  free(test);
+
+  CuAssertIntEquals(tc, 0, 0);
+}
+#endif
+
+/*
+        Math stuff
+*/
+
+int *gcdD(int a, int b) {
+  int *xyz = lib_malloc(sizeof(int) * 3);
+
+  if (b == 0) {
+    xyz[0] = a;
+    xyz[1] = 1;
+    xyz[2] = 0;
+  } else {
+    int n = a / b;
+    int c = a % b;
+    int *r = gcdD(b, c);
+
+    xyz[0] = r[0];
+    xyz[1] = r[2];
+    xyz[2] = r[1] - r[2] * n;
+
+    lib_free(r, sizeof(int) * 3);
+  }
+
+  return xyz;
+}
+
+/*
+        More math stuff
+*/
+
+int modInverse(int k) {
+  k = k % prime;
+
+  if (k < 0) {
+    k += prime;
+  }
+
+  /* Fermat: k^(p - 2) = k^-1 mod p, with no allocations (unlike gcdD()) */
+  return modular_exponentiation(k, prime - 2, prime);
+}
+
+/*
+        join_shares() -- join some shares to retrieve the secret
+        xy_pairs is array of int pairs, first is x, second is y
+        n is number of pairs submitted
+*/
+
+int join_shares(int *xy_pairs, int n) {
+  int secret = 0;
+  long numerator;
+  long denominator;
+  long startposition;
+  long nextposition;
+  long value;
+  int i;
+  int j;
+
+  // Pairwise calculations between all shares
+  for (i = 0; i < n; ++i) {
+    numerator = 1;
+    denominator = 1;
+
+    for (j = 0; j < n; ++j) {
+      if (i != j) {
+        startposition = xy_pairs[i * 2];  // x for share i
+        nextposition = xy_pairs[j * 2];   // x for share j
+        numerator = (numerator * -nextposition) % prime;
+        denominator = (denominator * (startposition - nextposition)) % prime;
+      }
+    }
+
+    value = xy_pairs[i * 2 + 1];
+
+    secret = (secret + (value * numerator * modInverse(denominator))) % prime;
+  }
+
+  /* Sometimes we're getting negative numbers, and need to fix that */
+  secret = (secret + prime) % prime;
+
+  return secret;
+}
+
+#ifdef TEST
+void Test_join_shares(CuTest *tc) {
+  int n = 200;
+  int t = 100;
+
+  int shares[n * 2];
+
+  int count = 255; /* How many times should we test it? */
+  int j;
+
+  for (j = 0; j < count; ++j) {
+    int *test = split_number(j, n, t);
+    int i;
+
+    for (i = 0; i < n; ++i) {
+      shares[i * 2] = i + 1;
+      shares[i * 2 + 1] = test[i];
+    }
+
+    /* Send all n shares */
+    int result = join_shares(shares, n);
+
+    free(test);
+
+    CuAssertIntEquals(tc, j, result);
+  }
+}
+#endif
+
+/*
+        Tiled split kernel
+
+        Every secret byte gets its own random polynomial of degree t - 1.
+        Rather than building one polynomial at a time, the kernel works on a
+        tile of bytes: the random coefficients for the whole tile are drawn in
+        one go, stored coefficient-major, and each share is then evaluated for
+        every byte in the tile with Horner's rule.  The inner loops run across
+        the bytes of the tile, so they are free of branches and allocations
+        and can be vectorised.
+
+        A tile holds at most SPLIT_TILE_SIZE bytes, and fewer for large `t`,
+        so the coefficient buffer stays within SPLIT_COEFFICIENT_BUDGET
+        entries.
+*/
+
+#define SPLIT_TILE_SIZE 256
+#define SPLIT_COEFFICIENT_BUDGET 2048
+
+/* Share value -> codon characters; 256 >> 4 picks 'G' so it encodes as 'G0' */
+static const char codon_digits[] = "0123456789ABCDEFG";
+
+/* Write the 6 character header of share `x` with threshold `t`, no terminator */
+static void write_share_header(char *out, int x, int t) {
+  out[0] = codon_digits[x >> 4];
+  out[1] = codon_digits[x & 0xF];
+  out[2] = codon_digits[t >> 4];
+  out[3] = codon_digits[t & 0xF];
+  out[4] = 'A';
+  out[5] = 'A';
+}
+
+struct split_tile {
+  size_t size;           // Bytes per tile
+  size_t coef_count;     // Entries in `coef`
+  unsigned short *coef;  // (t - 1) rows of `size` random coefficients
+  unsigned int *acc;     // One accumulator per byte
+};
+
+#if defined(SHAMIR_TA) || defined(HAVE_GETRANDOM)
+/*
+        rand() is not seeded from any entropy source inside a TA, and is not
+        fit for key material anywhere, so draw 16-bit values from the TEE's
+        RNG or from getrandom() when one is available.  65535 = 255 * 257, so
+        rejecting 65535 leaves every coefficient exactly uniform.
+*/
+
+static void random_bytes(void *buffer, size_t size) {
+#ifdef SHAMIR_TA
+  TEE_GenerateRandom(buffer, size);
+#else
+  char *p = buffer;
+
+  while (size > 0) {
+    ssize_t got = getrandom(p, size, 0);
+
+    if (got < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      abort();
+    }
+
+    p += got;
+    size -= got;
+  }
+#endif
+}
+
+static void fill_random_coefficients(unsigned short *coef, size_t count) {
+  uint16_t random[64];
+  size_t i = 0;
+
+  while (i < count) {
+    size_t j;
+
+    random_bytes(random, sizeof(random));
+
+    for (j = 0; (j < 64) && (i < count); ++j) {
+      if (random[j] != 65535) {
+        coef[i++] = random[j] % prime;
+      }
+    }
+  }
+}
+#else
+static void fill_random_coefficients(unsigned short *coef, size_t count) {
+  size_t i;
+
+  for (i = 0; i < count; ++i) {
+    /* Generate random coefficients -- use arc4random if available */
+#ifdef HAVE_ARC4RANDOM
+    coef[i] = arc4random_uniform(prime);
+#else
+    coef[i] = rand() % (prime);
+#endif
+  }
+}
+#endif
+
+void shamir_random_coefficients(unsigned short *coef, size_t count) {
+  fill_random_coefficients(coef, count);
+}
+
+static int split_tile_init(struct split_tile *tile, int t) {
+  tile->size = SPLIT_TILE_SIZE;
+
+  if ((t > 1) && (tile->size * (t - 1) > SPLIT_COEFFICIENT_BUDGET)) {
+    tile->size = SPLIT_COEFFICIENT_BUDGET / (t - 1);
+
+    if (tile->size < 1) {
+      tile->size = 1;
+    }
+  }
+
+  tile->coef_count = tile->size * (t > 1 ? t - 1 : 1);
+
+  PROFILE_START(alloc);
+  tile->coef = lib_malloc(sizeof(unsigned short) * tile->coef_count);
+  tile->acc = lib_malloc(sizeof(unsigned int) * tile->size);
+  PROFILE_STOP(alloc, SHAMIR_PHASE_ALLOC);
+
+  return (tile->coef != NULL) && (tile->acc != NULL);
+}
+
+static void split_tile_free(struct split_tile *tile) {
+  PROFILE_START(alloc);
+  /* Reverse order of split_tile_init(), so an arena can pop both */
+  lib_free(tile->acc, sizeof(unsigned int) * tile->size);
+  lib_free(tile->coef, sizeof(unsigned short) * tile->coef_count);
+  PROFILE_STOP(alloc, SHAMIR_PHASE_ALLOC);
+}
+
+/*
+        evaluate_tile() -- write the codons for `block` (<= tile size) bytes of
+                `secret` into `out[j] + 2 * pos` for each of the `n` shares
+*/
+
+static void evaluate_tile(struct split_tile *tile, const unsigned char *secret,
+                          size_t block, int n, int t, char **out, size_t pos) {
+  unsigned short *coef = tile->coef;
+  unsigned int *acc = tile->acc;
+  size_t k;
+  int x;
+  int i;
+
+  PROFILE_START(random);
+  fill_random_coefficients(coef, block * (t - 1));
+  PROFILE_STOP(random, SHAMIR_PHASE_RANDOM);
+
+  for (x = 1; x <= n; ++x) {
+    char *codon = out[x - 1] + pos * 2;
+
+    PROFILE_START(evaluate);
+
+    if (t > 1) {
+      const unsigned short *row = coef + (t - 2) * block;
+
+      for (k = 0; k < block; ++k) {
+        acc[k] = row[k];
+      }
+
+      for (i = t - 3; i >= 0; --i) {
+        row = coef + i * block;
+
+        for (k = 0; k < block; ++k) {
+          acc[k] = (acc[k] * x + row[k]) % prime;
+        }
+      }
+
+      for (k = 0; k < block; ++k) {
+        acc[k] = (acc[k] * x + secret[k]) % prime;
+      }
+    } else {
+      for (k = 0; k < block; ++k) {
+        acc[k] = secret[k];
+      }
+    }
+
+    PROFILE_STOP(evaluate, SHAMIR_PHASE_EVALUATE);
+    PROFILE_START(encode);
+
+    for (k = 0; k < block; ++k) {
+      codon[k * 2] = codon_digits[acc[k] >> 4];
+      codon[k * 2 + 1] = codon_digits[acc[k] & 0xF];
+    }
+
+    PROFILE_STOP(encode, SHAMIR_PHASE_ENCODE);
+  }
+}
+
+/*
+        split_bytes() -- write the codons for `len` bytes of `secret` into
+                `rows[j]` for each of the `n` shares (no header, no terminator)
+*/
+
+static void split_with_tile(struct split_tile *tile,
+                            const unsigned char *secret, size_t len, int n,
+                            int t, char **rows) {
+  size_t start;
+
+  for (start = 0; start < len; start += tile->size) {
+    size_t block = len - start;
+
+    if (block > tile->size) {
+      block = tile->size;
+    }
+
+    evaluate_tile(tile, secret + start, block, n, t, rows, start);
+  }
+}
+
+static int split_bytes(const unsigned char *secret, size_t len, int n, int t,
+                       char **rows) {
+  struct split_tile tile;
+
+  if (!split_tile_init(&tile, t)) {
+    split_tile_free(&tile);
+    return 0;
+  }
+
+  split_with_tile(&tile, secret, len, n, t, rows);
+
+  split_tile_free(&tile);
+
+  return 1;
+}
+
+/*
+        Streaming split
+
+        Each byte of the secret is split independently, so a secret can be fed
+        through in chunks of any size and the shares come out in matching
+        chunks.  The stream only holds the kernel's tile buffers, so memory use
+        is bounded no matter how large the secret is.
+*/
+
+struct split_stream {
+  int n;
+  int t;
+  struct split_tile tile;
+  char **rows;
+};
+
+struct split_stream *split_stream_new(int n, int t) {
+  if ((n < 1) || (n > 255) || (t < 1) || (t > n)) {
+    return NULL;
+  }
+
+  struct split_stream *stream = lib_malloc(sizeof(struct split_stream));
+
+  if (stream == NULL) {
+    return NULL;
+  }
+
+  stream->n = n;
+  stream->t = t;
+  stream->rows = lib_malloc(sizeof(char *) * n);
+
+  if (!split_tile_init(&stream->tile, t) || (stream->rows == NULL)) {
+    split_stream_free(stream);
+    return NULL;
+  }
+
+  return stream;
+}
+
+void split_stream_free(struct split_stream *stream) {
+  if (stream == NULL) {
+    return;
+  }
+
+  split_tile_free(&stream->tile);
+  lib_free(stream->rows, sizeof(char *) * stream->n);
+  lib_free(stream, sizeof(struct split_stream));
+}
+
+/* Write the 6 character header of share `x` (1 - n), without a terminator */
+void split_stream_header(const struct split_stream *stream, int x, char *out) {
+  write_share_header(out, x, stream->t);
+}
+
+/*
+        split_stream_feed() -- split the next `len` bytes of the secret,
+                writing share j's `2 * len` codon characters to
+                `out + j * row_stride`
+*/
+
+void split_stream_feed(struct split_stream *stream, const char *chunk,
+                       size_t len, char *out, size_t row_stride) {
+  int i;
+
+  for (i = 0; i < stream->n; ++i) {
+    stream->rows[i] = out + i * row_stride;
+  }
+
+  split_with_tile(&stream->tile, (const unsigned char *)chunk, len, stream->n,
+                  stream->t, stream->rows);
+}
+
+#ifdef TEST
+void Test_split_stream(CuTest *tc) {
+  char *phrase = "Streams of shares, chunk by chunk, still join back.";
+  size_t len = strlen(phrase);
+  size_t stride = 6 + 2 * len;
+  int n = 6;
+  int t = 4;
+  char *matrix = malloc(stride * n + 1);
+  char *shares[6];
+  size_t done = 0;
+  size_t chunk = 7;
+  int i;
+
+  struct split_stream *stream = split_stream_new(n, t);
+
+  CuAssertPtrNotNull(tc, stream);
+
+  for (i = 0; i < n; ++i) {
+    split_stream_header(stream, i + 1, matrix + i * stride);
+    shares[i] = matrix + i * stride;
+  }
+
+  while (done < len) {
+    if (chunk > len - done) {
+      chunk = len - done;
+    }
+
+    split_stream_feed(stream, phrase + done, chunk, matrix + 6 + done * 2, stride);
+    done += chunk;
+  }
+
+  split_stream_free(stream);
+
+  char *answer = join_strings_range(shares + 1, t, 0, len);
+  CuAssertStrEquals(tc, phrase, answer);
+  free(answer);
+
+  CuAssertPtrEquals(tc, NULL, split_stream_new(3, 4));
+
+  free(matrix);
+}
+#endif
+
+/*
+        split_string() -- Divide a string into shares
+        return an array of pointers to strings;
+*/
+
+char **split_string(char *secret, int n, int t) {
+  int len = strlen(secret);
+
+  PROFILE_START(alloc);
+  char **shares = lib_calloc(n, sizeof(char *));
+  char **rows = lib_malloc(sizeof(char *) * n);
+  int ok = (shares != NULL) && (rows != NULL);
+  int i;
+
+  for (i = 0; ok && (i < n); ++i) {
+    /* need two characters to encode each character */
+    /* Need 4 character overhead for share # and quorum # */
+    /* Additional 2 characters are for compatibility with:
+
+            http://www.christophedavid.org/w/c/w.php/Calculators/ShamirSecretSharing
+    */
+    shares[i] = (char *)lib_malloc(2 * len + 6 + 1);
+    ok = shares[i] != NULL;
+  }
+  PROFILE_STOP(alloc, SHAMIR_PHASE_ALLOC);
+
+  /* Now, handle the secret */
+  if (ok) {
+    PROFILE_START(encode);
+    for (i = 0; i < n; ++i) {
+      write_share_header(shares[i], i + 1, t);
+      rows[i] = shares[i] + 6;
+    }
+    PROFILE_STOP(encode, SHAMIR_PHASE_ENCODE);
+
+    ok = split_bytes((const unsigned char *)secret, len, n, t, rows);
+  }
+
+  PROFILE_START(release);
+  lib_free(rows, sizeof(char *) * n);
+
+  if (!ok) {
+    /* The codons were never written, so the lengths are not strlen()'s */
+    for (i = 0; (shares != NULL) && (i < n); ++i) {
+      lib_free(shares[i], 2 * len + 6 + 1);
+    }
+
+    lib_free(shares, sizeof(char *) * n);
+    shares = NULL;
+  }
+  PROFILE_STOP(release, SHAMIR_PHASE_ALLOC);
+
+  for (i = 0; (shares != NULL) && (i < n); ++i) {
+    shares[i][6 + len * 2] = '\0';
+  }
+
+  return shares;
+}
+
+void free_string_shares(char **shares, int n) {
+  int i;
+
+  PROFILE_START(alloc);
+
+  for (i = 0; i < n; ++i) {
+    if (shares[i] != NULL) {
+      lib_free(shares[i], strlen(shares[i]) + 1);
+    }
+  }
+
+  lib_free(shares, sizeof(char *) * n);
+
+  PROFILE_STOP(alloc, SHAMIR_PHASE_ALLOC);
+}
+
+/*
+        split_many() -- split many (usually small) secrets in one call
+
+        All records share the same `n` and `t`.  Their bytes are packed into
+        full tiles for the split kernel, so randomness is drawn and shares are
+        evaluated a tile at a time no matter how short each record is, and the
+        codons are then copied out to the records' places in the bundles.
+
+        Returns `n` bundles, one per node.  Bundle j holds share j + 1 of every
+        record, in record order, as one `\n` terminated line each -- the same
+        layout generate_share_strings() uses.  Free with free_string_shares().
+*/
+
+struct split_segment {
+  size_t offset;  // Where the segment's first codon goes in every bundle
+  size_t start;   // Position of the segment within the packed tile
+  size_t len;     // Bytes in the segment
+};
+
+char **split_many(const struct secret_record *records, int count, int n,
+                  int t) {
+  if ((records == NULL) || (count < 1) || (n < 1) || (n > 255) || (t < 1) ||
+      (t > n)) {
+    return NULL;
+  }
+
+  size_t total = 0;
+  int r;
+  int i;
+
+  /* The bundles, with their terminators, must fit in a size_t */
+  for (r = 0; r < count; ++r) {
+    if (records[r].len > (SIZE_MAX - 8) / 2) {
+      return NULL;
+    }
+
+    size_t line = 6 + 2 * records[r].len + 1;
+
+    if (total > SIZE_MAX - 1 - line) {
+      return NULL;
+    }
+
+    total += line;
+  }
+
+  char **bundles = lib_malloc(sizeof(char *) * n);
+  char **codons = lib_malloc(sizeof(char *) * n);
+  struct split_tile tile;
+
+  int ok = split_tile_init(&tile, t);
+
+  unsigned char *packed = lib_malloc(tile.size);
+  char *scratch = lib_malloc(n * tile.size * 2);
+  struct split_segment *segments =
+      lib_malloc(sizeof(struct split_segment) * tile.size);
+
+  ok = ok && bundles && codons && packed && scratch && segments;
+
+  for (i = 0; ok && (i < n); ++i) {
+    bundles[i] = lib_malloc(total + 1);
+    codons[i] = scratch + i * tile.size * 2;
+
+    if (bundles[i] == NULL) {
+      while (i-- > 0) {
+        lib_free(bundles[i], total + 1);
+      }
+
+      lib_free(bundles, sizeof(char *) * n);
+      bundles = NULL;
+      ok = 0;
+    }
+  }
+
+  if (ok) {
+    /* Lay out the headers and line breaks of every record */
+    size_t offset = 0;
+
+    for (r = 0; r < count; ++r) {
+      for (i = 0; i < n; ++i) {
+        write_share_header(bundles[i] + offset, i + 1, t);
+        bundles[i][offset + 6 + 2 * records[r].len] = '\n';
+      }
+
+      offset += 6 + 2 * records[r].len + 1;
+    }
+
+    for (i = 0; i < n; ++i) {
+      bundles[i][total] = '\0';
+    }
+
+    /* Stream every record's bytes through the kernel a full tile at a time */
+    size_t filled = 0;
+    int segment_count = 0;
+    int done = 0;
+    size_t consumed = 0;
+
+    offset = 0;
+    r = 0;
+
+    while (!done) {
+      while ((r < count) && (filled < tile.size)) {
+        size_t take = records[r].len - consumed;
+
+        if (take > tile.size - filled) {
+          take = tile.size - filled;
+        }
+
+        if (take > 0) {
+          memcpy(packed + filled, records[r].secret + consumed, take);
+
+          segments[segment_count].offset = offset + 6 + 2 * consumed;
+          segments[segment_count].start = filled;
+          segments[segment_count].len = take;
+          segment_count++;
+
+          filled += take;
+          consumed += take;
+        }
+
+        if (consumed == records[r].len) {
+          offset += 6 + 2 * records[r].len + 1;
+          consumed = 0;
+          r++;
+        }
+      }
+
+      done = (r == count);
+
+      if (filled == 0) {
+        continue;
+      }
+
+      evaluate_tile(&tile, packed, filled, n, t, codons, 0);
+
+      for (i = 0; i < n; ++i) {
+        int s;
+
+        for (s = 0; s < segment_count; ++s) {
+          memcpy(bundles[i] + segments[s].offset,
+                 codons[i] + 2 * segments[s].start, 2 * segments[s].len);
+        }
+      }
+
+      filled = 0;
+      segment_count = 0;
+    }
+  } else if (bundles != NULL) {
+    lib_free(bundles, sizeof(char *) * n);
+    bundles = NULL;
+  }
+
+  split_tile_free(&tile);
+  lib_free(packed, tile.size);
+  lib_free(scratch, n * tile.size * 2);
+  lib_free(segments, sizeof(struct split_segment) * tile.size);
+  lib_free(codons, sizeof(char *) * n);
+
+  return bundles;
+}
+
+/*
+        Hex digit values for decoding share codons.  'G' is 16, so the
+        special 'G0' codon decodes to 256 through the same arithmetic.
+*/
+
+static const unsigned char hex_value[256] = {
+    ['0'] = 0,  ['1'] = 1,  ['2'] = 2,  ['3'] = 3,  ['4'] = 4,  ['5'] = 5,
+    ['6'] = 6,  ['7'] = 7,  ['8'] = 8,  ['9'] = 9,  ['A'] = 10, ['B'] = 11,
+    ['C'] = 12, ['D'] = 13, ['E'] = 14, ['F'] = 15, ['G'] = 16, ['a'] = 10,
+    ['b'] = 11, ['c'] = 12, ['d'] = 13, ['e'] = 14, ['f'] = 15, ['g'] = 16};
+
+/* Decode the two characters of one share value ('00' - 'FF', 'G0' = 256) */
+static int decode_codon(const char *codon) {
+  return hex_value[(unsigned char)codon[0]] * 16 +
+         hex_value[(unsigned char)codon[1]];
+}
+
+/*
+        Lagrange basis cache
+
+        Interpolating at x = 0 reduces every join to a weighted sum of the
+        share values,
+
+                secret = sum(w_i * y_i),  w_i = prod(x_j / (x_j - x_i)), j != i
+
+        and the weights depend only on which x values (and which prime) were
+        used.  Consumers usually reconstruct from the same few node sets, so the
+        weights are kept in a small process-wide LRU cache keyed by the sorted
+        x set and the prime.  Weights are stored indexed by x value, so callers
+        can present the shares in any order.
+
+        The cache is not locked; callers joining from several threads at once
+        must serialise their calls.
+*/
+
+#ifndef LAGRANGE_CACHE_SIZE
+  #define LAGRANGE_CACHE_SIZE 8
+#endif
+
+/* Number of bytes reconstructed per pass of the accumulation loop */
+#define JOIN_BLOCK_SIZE 128
+
+struct lagrange_entry {
+  int prime;                   // Field the weights belong to
+  int count;                   // Number of x values (0 = unused entry)
+  unsigned char x[255];        // Sorted x values
+  unsigned short weight[257];  // Weight for each x value
+  unsigned long last_used;     // LRU stamp
+};
+
+static struct lagrange_entry lagrange_cache[LAGRANGE_CACHE_SIZE];
+static unsigned long lagrange_clock = 0;
+
+/*
+        lagrange_weights() -- return the weights for the x values of `n` shares
+                (indexed by x), computing and caching them if needed.  Returns
+                NULL if an x value is out of range or repeated.
+*/
+
+static const unsigned short *lagrange_weights(const int *x, int n) {
+  unsigned char sorted[255];
+  struct lagrange_entry *entry = &lagrange_cache[0];
+  int i;
+  int j;
+
+  if ((n < 1) || (n > 255)) {
+    return NULL;
+  }
+
+  /* Insertion sort -- n is at most 255 */
+  for (i = 0; i < n; ++i) {
+    if ((x[i] < 1) || (x[i] > 255)) {
+      return NULL;
+    }
+
+    for (j = i; (j > 0) && (sorted[j - 1] > x[i]); --j) {
+      sorted[j] = sorted[j - 1];
+    }
+
+    if ((j > 0) && (sorted[j - 1] == x[i])) {
+      return NULL;
+    }
+
+    sorted[j] = x[i];
+  }
+
+  for (i = 0; i < LAGRANGE_CACHE_SIZE; ++i) {
+    struct lagrange_entry *e = &lagrange_cache[i];
+
+    if ((e->count == n) && (e->prime == prime) &&
+        (memcmp(e->x, sorted, n) == 0)) {
+      e->last_used = ++lagrange_clock;
+      return e->weight;
+    }
+
+    if (e->last_used < entry->last_used) {
+      entry = e;
+    }
+  }
+
+  /* Miss -- overwrite the least recently used entry */
+  entry->prime = prime;
+  entry->count = n;
+  memcpy(entry->x, sorted, n);
+
+  for (i = 0; i < n; ++i) {
+    long numerator = 1;
+    long denominator = 1;
+
+    for (j = 0; j < n; ++j) {
+      if (i != j) {
+        numerator = (numerator * sorted[j]) % prime;
+        denominator = (denominator * (sorted[j] - sorted[i] + prime)) % prime;
+      }
+    }
+
+    entry->weight[sorted[i]] = (numerator * modInverse(denominator)) % prime;
+  }
+
+  entry->last_used = ++lagrange_clock;
+
+  return entry->weight;
+}
+
+/*
+        lagrange_combine() -- rebuild bytes [offset, offset + length) from `n`
+                shares with precomputed weights, writing them to `result`
+
+        The loop runs share by share over a block of accumulators, so the
+        inner loop is a plain multiply-add the compiler can vectorise.  Each
+        term is at most 256 * 256, so 255 of them fit in 32 bits before the
+        single reduction at the end.
+*/
+
+static void lagrange_combine(char **shares, int n, const int *x,
+                             const unsigned short *weight, size_t offset,
+                             size_t length, char *result) {
+  unsigned int acc[JOIN_BLOCK_SIZE];
+  size_t start;
+  size_t k;
+  int i;
+
+  for (start = 0; start < length; start += JOIN_BLOCK_SIZE) {
+    size_t block = length - start;
+
+    if (block > JOIN_BLOCK_SIZE) {
+      block = JOIN_BLOCK_SIZE;
+    }
+
+    memset(acc, 0, sizeof(unsigned int) * block);
+
+    for (i = 0; i < n; ++i) {
+      const char *codon = shares[i] + 6 + (offset + start) * 2;
+      unsigned int w = weight[x[i]];
+
+      for (k = 0; k < block; ++k) {
+        acc[k] += w * decode_codon(codon + k * 2);
+      }
+    }
+
+    for (k = 0; k < block; ++k) {
+      result[start + k] = (char)(acc[k] % prime);
+    }
+  }
+}
+
+/*
+        join_strings_range() -- recreate `length` bytes of the secret, starting
+                at byte `offset`
+
+        Byte i of the secret lives at characters `6 + i * 2` of every share, so
+        only the codons inside the requested window are read.  The shares are
+        never scanned with strlen(), which keeps the cost proportional to the
+        range rather than to the size of the secret -- the caller is
+        responsible for making sure every share covers `offset + length`.
+
+        The result is always `length` bytes plus a terminating '\0', and may
+        contain embedded zero bytes if the secret did.
+
+        join_strings_range_into() does the same into a caller supplied buffer
+        of at least `length` bytes (nothing is appended) and returns 0 if the
+        shares could not be used.
+*/
+
+int join_strings_range_into(char **shares, int n, size_t offset,
+                            size_t length, char *result) {
+  /* TODO: Check if we have a quorum */
+
+  if ((n == 0) || (n > 255) || (shares == NULL) || (result == NULL)) {
+    return 0;
+  }
+
+  int x[n];  // Integer value array
+  int i;     // Counter
+
+  // Determine x value for each share
+  for (i = 0; i < n; ++i) {
+    if (shares[i] == NULL) {
+      return 0;
+    }
+
+    x[i] = decode_codon(shares[i]);
+  }
+
+  PROFILE_START(evaluate);
+  const unsigned short *weight = lagrange_weights(x, n);
+
+  if (weight != NULL) {
+    lagrange_combine(shares, n, x, weight, offset, length, result);
+  }
+  PROFILE_STOP(evaluate, SHAMIR_PHASE_EVALUATE);
+
+  return weight != NULL;
+}
+
+char *join_strings_range(char **shares, int n, size_t offset, size_t length) {
+  PROFILE_START(alloc);
+  char *result = lib_malloc(length + 1);
+  PROFILE_STOP(alloc, SHAMIR_PHASE_ALLOC);
+
+  if (result == NULL) {
+    return NULL;
+  }
+
+  if (!join_strings_range_into(shares, n, offset, length, result)) {
+    lib_free(result, length + 1);
+    return NULL;
+  }
+
+  result[length] = '\0';
+
+  return result;
+}
+
+char *join_strings(char **shares, int n) {
+  if ((n == 0) || (shares == NULL) || (shares[0] == NULL)) {
+    return NULL;
+  }
+
+  size_t share_len = strlen(shares[0]);
+
+  if (share_len < 6) {
+    return NULL;
+  }
+
+  // `len` = number of hex pair values in shares
+  size_t len = (share_len - 6) / 2;
+
+  return join_strings_range(shares, n, 0, len);
+}
+
+/*
+        join_many() -- recreate several secrets in one call
+
+        `share_sets[r]` holds the `counts[r]` share strings for record r.
+        Records are grouped by the set of x values their shares carry, and every
+        record in a group is rebuilt with the same weight vector, so the cache
+        is consulted once per distinct node set rather than once per record.
+
+        Returns an array of `records` secrets (free each with free(), then the
+        array -- or with shamir_free() under a custom allocator); an entry is
+        NULL if that record's shares were unusable.
+*/
+
+struct join_many_key {
+  unsigned char present[32];  // Bitmap of the x values in the record
+  int record;
+};
+
+static int compare_join_many_key(const void *a, const void *b) {
+  const struct join_many_key *ka = a;
+  const struct join_many_key *kb = b;
+  int diff = memcmp(ka->present, kb->present, sizeof(ka->present));
+
+  return diff ? diff : ka->record - kb->record;
+}
+
+char **join_many(char ***share_sets, const int *counts, int records) {
+  if ((share_sets == NULL) || (counts == NULL) || (records < 1)) {
+    return NULL;
+  }
+
+  char **secrets = lib_calloc(records, sizeof(char *));
+  struct join_many_key *keys =
+      lib_calloc(records, sizeof(struct join_many_key));
+  int x[255];
+  int r;
+  int i;
+
+  if ((secrets == NULL) || (keys == NULL)) {
+    lib_free(secrets, sizeof(char *) * records);
+    lib_free(keys, sizeof(struct join_many_key) * records);
+    return NULL;
+  }
+
+  for (r = 0; r < records; ++r) {
+    keys[r].record = r;
+
+    if ((share_sets[r] == NULL) || (counts[r] < 1) || (counts[r] > 255)) {
+      continue;
+    }
+
+    for (i = 0; i < counts[r]; ++i) {
+      if (share_sets[r][i] == NULL) {
+        break;
+      }
+
+      int value = decode_codon(share_sets[r][i]) & 0xFF;
+      keys[r].present[value / 8] |= 1 << (value % 8);
+    }
+  }
+
+  qsort(keys, records, sizeof(struct join_many_key), compare_join_many_key);
+
+  const unsigned short *weight = NULL;
+  const struct join_many_key *weight_key = NULL;
+  int weight_n = 0;
+
+  for (r = 0; r < records; ++r) {
+    int record = keys[r].record;
+    char **shares = share_sets[record];
+    int n = counts[record];
+
+    if ((shares == NULL) || (n < 1) || (n > 255)) {
+      continue;
+    }
+
+    for (i = 0; i < n; ++i) {
+      if (shares[i] == NULL) {
+        break;
+      }
+
+      x[i] = decode_codon(shares[i]);
+    }
+
+    if ((i < n) || (strlen(shares[0]) < 6)) {
+      continue;
+    }
+
+    /* Same node set as the last record we joined -- reuse its weights */
+    if ((weight_key == NULL) || (weight_n != n) ||
+        (memcmp(keys[r].present, weight_key->present,
+                sizeof(keys[r].present)) != 0)) {
+      weight = lagrange_weights(x, n);
+      weight_key = &keys[r];
+      weight_n = n;
+    }
+
+    if (weight == NULL) {
+      continue;
+    }
+
+    size_t len = (strlen(shares[0]) - 6) / 2;
+    char *result = lib_malloc(len + 1);
+
+    if (result == NULL) {
+      continue;
+    }
+
+    lagrange_combine(shares, n, x, weight, 0, len, result);
+    result[len] = '\0';
+
+    secrets[record] = result;
+  }
+
+  lib_free(keys, sizeof(struct join_many_key) * records);
+
+  return secrets;
+}
+
+#ifdef TEST
+void Test_split_string(CuTest *tc) {
+  int n = 255; /* Maximum n = 255 */
+  int t = 254; /* t <= n, we choose less than that so we have two tests */
+
+  char *phrase = "This is a test of Bücher and Später.";
+
+  int count = 10;
+  int i;
+
+  for (i = 0; i < count; ++i) {
+    char **result = split_string(phrase, n, t);
+
+    /* Extract secret using first t shares */
+    char *answer = join_strings(result, t);
+    CuAssertStrEquals(tc, phrase, answer);
+    free(answer);
+
+    /* Extract secret using all shares */
+    answer = join_strings(result, n);
+    CuAssertStrEquals(tc, phrase, answer);
+    free(answer);
+
+    free_string_shares(result, n);
+  }
+}
+#endif
+
+#ifdef TEST
+void Test_join_strings_range(CuTest *tc) {
+  int n = 10;
+  int t = 7;
+
+  char *phrase = "{\"ID\": 3, \"name\": \"Bücher\", \"age\": 42}";
+  size_t len = strlen(phrase);
+
+  char **result = split_string(phrase, n, t);
+
+  /* Middle of the secret, from the last t shares */
+  char *answer = join_strings_range(result + (n - t), t, 6, 14);
+  CuAssertIntEquals(tc, 0, memcmp(answer, phrase + 6, 14));
+  CuAssertIntEquals(tc, '\0', answer[14]);
+  free(answer);
+
+  /* Tail of the secret */
+  answer = join_strings_range(result, t, len - 3, 3);
+  CuAssertStrEquals(tc, phrase + len - 3, answer);
+  free(answer);
+
+  /* Empty range */
+  answer = join_strings_range(result, t, 0, 0);
+  CuAssertStrEquals(tc, "", answer);
+  free(answer);
+
+  CuAssertPtrEquals(tc, NULL, join_strings_range(NULL, t, 0, 1));
+
+  free_string_shares(result, n);
+}
+#endif
+
+#ifdef TEST
+void Test_join_many(CuTest *tc) {
+  char *phrases[] = {"alpha", "Bücher und Später", "", "gamma gamma gamma"};
+  char **split[4];
+  char **sets[5];
+  int counts[5];
+  char *duplicate[3];
+  int r;
+
+  for (r = 0; r < 4; ++r) {
+    split[r] = split_string(phrases[r], 10, 4);
+  }
+
+  /* Records 0 and 3 share an x set, 1 and 2 use different ones */
+  sets[0] = split[0];
+  counts[0] = 4;
+  sets[1] = split[1] + 6;
+  counts[1] = 4;
+  sets[2] = split[2] + 1;
+  counts[2] = 9;
+  sets[3] = split[3];
+  counts[3] = 4;
+
+  /* Repeated x value can't be interpolated */
+  duplicate[0] = split[0][0];
+  duplicate[1] = split[0][0];
+  duplicate[2] = split[0][1];
+  sets[4] = duplicate;
+  counts[4] = 3;
+
+  char **secrets = join_many(sets, counts, 5);
+
+  for (r = 0; r < 4; ++r) {
+    CuAssertStrEquals(tc, phrases[r], secrets[r]);
+    free(secrets[r]);
+  }
+
+  CuAssertPtrEquals(tc, NULL, secrets[4]);
+
+  free(secrets);
+
+  /* A second pass is served from the cache and must agree */
+  char *answer = join_strings(split[3] + 2, 4);
+  CuAssertStrEquals(tc, phrases[3], answer);
+  free(answer);
+
+  for (r = 0; r < 4; ++r) {
+    free_string_shares(split[r], 10);
+  }
+}
+#endif
+
+#ifdef TEST
+void Test_split_many(CuTest *tc) {
+  struct secret_record records[] = {
+      {"{\"ID\": 0}", 9}, {"", 0}, {"x", 1}, {"Bücher\0Später", 15}};
+  int count = sizeof(records) / sizeof(records[0]);
+  int n = 7;
+  int t = 5;
+  int r;
+  int i;
+
+  char **bundles = split_many(records, count, n, t);
+
+  CuAssertPtrNotNull(tc, bundles);
+
+  /* Cut every bundle into its per-record lines */
+  char *lines[7][4];
+
+  for (i = 0; i < n; ++i) {
+    char *cursor = bundles[i];
+
+    for (r = 0; r < count; ++r) {
+      lines[i][r] = cursor;
+      cursor = strchr(cursor, '\n');
+      *cursor++ = '\0';
+    }
+
+    CuAssertIntEquals(tc, '\0', *cursor);
+  }
+
+  for (r = 0; r < count; ++r) {
+    char *shares[5];
+
+    for (i = 0; i < t; ++i) {
+      shares[i] = lines[n - 1 - i][r];
+    }
+
+    char *answer = join_strings_range(shares, t, 0, records[r].len);
+    CuAssertIntEquals(tc, 0, memcmp(records[r].secret, answer, records[r].len));
+    free(answer);
+  }
+
+  free_string_shares(bundles, n);
+
+  CuAssertPtrEquals(tc, NULL, split_many(records, count, 3, 4));
+
+  /* Lengths whose bundles would not fit in a size_t */
+  struct secret_record huge[] = {
+      {"", SIZE_MAX / 2}, {"", SIZE_MAX / 4}, {"", SIZE_MAX / 4}};
+
+  CuAssertPtrEquals(tc, NULL, split_many(huge, 1, n, t));
+  CuAssertPtrEquals(tc, NULL, split_many(huge + 1, 2, n, t));
+}
+#endif
+
+/*
+        write_share_strings() -- split `len` bytes of `secret` and write the
+                share lines directly into `buffer`
+
+        `buffer` must hold share_strings_size(len, n) bytes.  The layout is the
+        one generate_share_strings() returns -- `n` lines of `6 + 2 * len`
+        characters, each ending in `\n` -- without the terminating '\0', so
+        the shares can be produced straight into memory owned by someone else
+        (e.g. a buffer shared with the normal world).
+
+        Returns 0 for bad arguments or when out of memory.
+*/
+
+size_t share_strings_size(size_t len, int n) { return (6 + 2 * len + 1) * n; }
+
+int write_share_strings(const char *secret, size_t len, int n, int t,
+                        char *buffer) {
+  if ((secret == NULL && len > 0) || (buffer == NULL) || (n < 1) ||
+      (n > 255) || (t < 1) || (t > n)) {
+    return 0;
+  }
+
+  size_t stride = 6 + 2 * len + 1;
+  PROFILE_START(alloc);
+  char **rows = lib_malloc(sizeof(char *) * n);
+  PROFILE_STOP(alloc, SHAMIR_PHASE_ALLOC);
+  int i;
+
+  if (rows == NULL) {
+    return 0;
+  }
+
+  PROFILE_START(encode);
+  for (i = 0; i < n; ++i) {
+    write_share_header(buffer + i * stride, i + 1, t);
+    buffer[i * stride + stride - 1] = '\n';
+    rows[i] = buffer + i * stride + 6;
+  }
+  PROFILE_STOP(encode, SHAMIR_PHASE_ENCODE);
+
+  int ok = split_bytes((const unsigned char *)secret, len, n, t, rows);
+
+  PROFILE_START(release);
+  lib_free(rows, sizeof(char *) * n);
+  PROFILE_STOP(release, SHAMIR_PHASE_ALLOC);
+
+  return ok;
+}
+
+#if defined(TEST) && defined(SHAMIR_PROFILE)
+void Test_shamir_profile(CuTest *tc) {
+  size_t len = 4096;
+  char *secret = malloc(len);
+  char *buffer = malloc(share_strings_size(len, 10));
+
+  memset(secret, 'x', len);
+  shamir_profile_reset();
+
+  CuAssertIntEquals(tc, 1, write_share_strings(secret, len, 10, 7, buffer));
+  CuAssertTrue(tc, shamir_profile_us(SHAMIR_PHASE_EVALUATE) > 0);
+
+  shamir_profile_reset();
+  CuAssertIntEquals(tc, 0, shamir_profile_us(SHAMIR_PHASE_EVALUATE));
+
+  free(secret);
+  free(buffer);
+}
+#endif
+
+#ifdef TEST
+static size_t test_allocator_live = 0;
+
+static void *test_alloc(size_t size, void *ctx) {
+  (void)ctx;
+  test_allocator_live += size;
+  return malloc(size);
+}
+
+static void test_free(void *ptr, size_t size, void *ctx) {
+  (void)ctx;
+  test_allocator_live -= size;
+  free(ptr);
+}
+
+/* test_alloc() that fails once test_allocs_left allocations have been made */
+static int test_allocs_left = 0;
+
+static void *test_alloc_limited(size_t size, void *ctx) {
+  if (test_allocs_left == 0) {
+    return NULL;
+  }
+
+  --test_allocs_left;
+  return test_alloc(size, ctx);
+}
+
+void Test_shamir_alloc_stats(CuTest *tc) {
+  struct shamir_allocator hooks = {test_alloc, test_free, NULL};
+  struct shamir_alloc_stats stats;
+
+  shamir_set_allocator(&hooks);
+  shamir_alloc_stats_reset();
+
+  char **shares = split_string("allocation accounting", 6, 4);
+  char *answer = join_strings(shares + 2, 4);
+
+  CuAssertStrEquals(tc, "allocation accounting", answer);
+  shamir_free(answer, strlen(answer) + 1);
+  free_string_shares(shares, 6);
+
+  /* Every allocation went back, with the size it was made with */
+  shamir_alloc_stats_get(&stats);
+  CuAssertTrue(tc, stats.allocs > 0);
+  CuAssertIntEquals(tc, stats.allocs, stats.frees);
+  CuAssertIntEquals(tc, 0, stats.live_bytes);
+  CuAssertTrue(tc, stats.peak_bytes > 0 && stats.peak_bytes <= stats.bytes);
+  CuAssertIntEquals(tc, 0, test_allocator_live);
+
+  answer = extract_secret_from_share_strings("0103AAFEBDB7A3F114\n0203AA1F407C51B784 \n\n0303AAD9F0B37DB8C3\n");
+  CuAssertStrEquals(tc, "secret", answer);
+  CuAssertIntEquals(tc, 7, test_allocator_live);
+  shamir_free(answer, 7);
+
+  /* A split that runs out of memory at any point fails whole, leaking nothing */
+  hooks.alloc = test_alloc_limited;
+  shamir_set_allocator(&hooks);
+
+  int allowed;
+
+  for (allowed = 0; allowed < 64; ++allowed) {
+    test_allocs_left = allowed;
+    shares = split_string("allocation accounting", 6, 4);
+
+    if (shares != NULL) {
+      CuAssertTrue(tc, allowed >= 8);
+      break;
+    }
+
+    CuAssertIntEquals(tc, 0, test_allocator_live);
+  }
+
+  CuAssertPtrNotNull(tc, shares);
+
+  /* join_many() drops only the records it had no memory for */
+  char **sets[2] = {shares, shares + 2};
+  int counts[2] = {4, 4};
+  size_t live = test_allocator_live;
+  int r;
+
+  for (allowed = 0; allowed < 64; ++allowed) {
+    test_allocs_left = allowed;
+    char **secrets = join_many(sets, counts, 2);
+
+    if (secrets == NULL) {
+      CuAssertIntEquals(tc, live, test_allocator_live);
+      continue;
+    }
+
+    int joined = 0;
+
+    for (r = 0; r < 2; ++r) {
+      if (secrets[r] != NULL) {
+        CuAssertStrEquals(tc, "allocation accounting", secrets[r]);
+        shamir_free(secrets[r], strlen(secrets[r]) + 1);
+        ++joined;
+      }
+    }
+
+    shamir_free(secrets, 2 * sizeof(char *));
+
+    CuAssertIntEquals(tc, live, test_allocator_live);
+
+    if (joined == 2) {
+      break;
+    }
+  }
+
+  CuAssertTrue(tc, allowed < 64);
+  test_allocs_left = -1;
+  free_string_shares(shares, 6);
+  CuAssertIntEquals(tc, 0, test_allocator_live);
+
+  shamir_set_allocator(NULL);
+}
+#endif
+
+#ifdef TEST
+void Test_shamir_arena(CuTest *tc) {
+  static char buffer[16 * 1024];
+  struct shamir_arena arena;
+  char secret[300];
+  char *out = malloc(share_strings_size(sizeof(secret), 20));
+  char *rows[12];
+  char result[300];
+  int i;
+
+  memset(secret, 'q', sizeof(secret));
+  shamir_arena_init(&arena, buffer, sizeof(buffer));
+  shamir_use_arena(&arena);
+
+  /* The working set is popped as it is freed */
+  CuAssertIntEquals(tc, 1, write_share_strings(secret, sizeof(secret), 20, 12, out));
+  CuAssertIntEquals(tc, 0, arena.used);
+  CuAssertTrue(tc, arena.high_water > 0);
+  CuAssertIntEquals(tc, 0, arena.fallbacks);
+
+  for (i = 0; i < 12; ++i) {
+    rows[i] = out + (size_t)(19 - i) * (6 + 2 * sizeof(secret) + 1);
+  }
+
+  CuAssertIntEquals(tc, 1, join_strings_range_into(rows, 12, 0, sizeof(secret), result));
+  CuAssertIntEquals(tc, 0, memcmp(secret, result, sizeof(secret)));
+
+  /* Results too big for the arena come from the heap and still free */
+  char *shares = generate_share_strings("spills over to the heap, and back", 255, 3);
+  CuAssertTrue(tc, arena.fallbacks > 0);
+  shamir_free(shares, strlen(shares) + 1);
+
+  shamir_use_arena(NULL);
+  free(out);
+}
+#endif
+
+#ifdef TEST
+void Test_write_share_strings(CuTest *tc) {
+  char secret[] = {'a', '\0', (char)0xFF, 'z'};
+  int n = 5;
+  int t = 3;
+  size_t size = share_strings_size(sizeof(secret), n);
+  char *buffer = malloc(size + 1);
+  char *rows[5];
+  char result[4];
+  int i;
+
+  buffer[size] = '#';
+
+  CuAssertIntEquals(tc, 1, write_share_strings(secret, sizeof(secret), n, t, buffer));
+  CuAssertIntEquals(tc, '#', buffer[size]);
+  CuAssertIntEquals(tc, '\n', buffer[size - 1]);
+
+  for (i = 0; i < n; ++i) {
+    rows[i] = buffer + (size / n) * (n - 1 - i);
+  }
+
+  CuAssertIntEquals(tc, 1, join_strings_range_into(rows, t, 0, sizeof(secret), result));
+  CuAssertIntEquals(tc, 0, memcmp(secret, result, sizeof(secret)));
+
+  CuAssertIntEquals(tc, 0, write_share_strings(secret, sizeof(secret), 3, 4, buffer));
+
+  free(buffer);
+}
+#endif
+
+/*
+        Compression stage
+
+        Secrets that compress well (records, JSON) can be compressed before
+        they are split, which cuts the polynomial work and the size of every
+        share by the compression ratio.  The codec is recorded in the last two
+        characters of each share's header, which are 'AA' for a secret stored
+        as it is and 'AB' for an LZ4 payload: the secret's length as 4 bytes,
+        little endian, then an LZ4 block (lz4_block.c).  A secret that would
+        not get smaller is stored as it is.
+
+        join_strings() and the other joins return the payload; the extract
+        functions decompress it.
+*/
+
+/* Codec characters of the share header, by codec */
+static const char codec_tags[][2] = {{'A', 'A'}, {'A', 'B'}};
+
+#define CODEC_LENGTH_SIZE 4
+
+int share_codec(const char *share) {
+  if ((share[4] == codec_tags[SHAMIR_CODEC_LZ4][0]) &&
+      (share[5] == codec_tags[SHAMIR_CODEC_LZ4][1])) {
+    return SHAMIR_CODEC_LZ4;
+  }
+
+  return SHAMIR_CODEC_NONE;
+}
+
+void share_set_codec(char *share, enum shamir_codec codec) {
+  share[4] = codec_tags[codec][0];
+  share[5] = codec_tags[codec][1];
+}
+
+size_t shamir_compress_bound(size_t len) {
+  return CODEC_LENGTH_SIZE + lz4_compress_bound(len);
+}
+
+size_t shamir_compress(enum shamir_codec codec, const char *secret, size_t len,
+                       char *out) {
+  if ((codec != SHAMIR_CODEC_LZ4) || (len > UINT32_MAX)) {
+    return 0;
+  }
+
+  PROFILE_START(alloc);
+  uint32_t *table = lib_malloc(sizeof(uint32_t) * LZ4_HASH_SIZE);
+  PROFILE_STOP(alloc, SHAMIR_PHASE_ALLOC);
+
+  if (table == NULL) {
+    return 0;
+  }
+
+  int i;
+
+  for (i = 0; i < CODEC_LENGTH_SIZE; ++i) {
+    out[i] = (char)((len >> (8 * i)) & 0xFF);
+  }
+
+  /* Only worth it if the payload comes out smaller than the secret */
+  size_t size = 0;
+
+  if (len > CODEC_LENGTH_SIZE) {
+    size = lz4_compress((const unsigned char *)secret, len,
+                        (unsigned char *)out + CODEC_LENGTH_SIZE,
+                        len - CODEC_LENGTH_SIZE - 1, table);
+  }
+
+  PROFILE_START(release);
+  lib_free(table, sizeof(uint32_t) * LZ4_HASH_SIZE);
+  PROFILE_STOP(release, SHAMIR_PHASE_ALLOC);
+
+  return size ? CODEC_LENGTH_SIZE + size : 0;
+}
+
+size_t shamir_decompressed_size(enum shamir_codec codec, const char *payload,
+                                size_t len) {
+  if (codec == SHAMIR_CODEC_NONE) {
+    return len;
+  }
+
+  if (len < CODEC_LENGTH_SIZE) {
+    return (size_t)-1;
+  }
+
+  size_t size = 0;
+  size_t block = len - CODEC_LENGTH_SIZE;
+  int i;
+
+  for (i = 0; i < CODEC_LENGTH_SIZE; ++i) {
+    size |= (size_t)(unsigned char)payload[i] << (8 * i);
+  }
+
+  /*
+     The length comes from the shares, so it is not trusted: an LZ4 block
+     cannot expand more than 255 times (each extra length byte adds at most
+     255), so anything longer is refused before a caller sizes a buffer by it
+  */
+  if ((block <= ((size_t)-1 - 16) / 255) && (size > block * 255 + 16)) {
+    return (size_t)-1;
+  }
+
+  return size;
+}
+
+int shamir_decompress(enum shamir_codec codec, const char *payload, size_t len,
+                      char *out, size_t size) {
+  if (codec == SHAMIR_CODEC_NONE) {
+    if (len != size) {
+      return 0;
+    }
+
+    memcpy(out, payload, len);
+    return 1;
+  }
+
+  if ((len < CODEC_LENGTH_SIZE) ||
+      (shamir_decompressed_size(codec, payload, len) != size)) {
+    return 0;
+  }
+
+  return lz4_decompress((const unsigned char *)payload + CODEC_LENGTH_SIZE,
+                        len - CODEC_LENGTH_SIZE, (unsigned char *)out,
+                        size) == size;
+}
+
+/* Split `len` bytes into the `n` share lines of one DString, handed over */
+static char *generate_lines(const char *secret, size_t len, int n, int t) {
+  size_t size = share_strings_size(len, n);
+  char *rows = NULL;
+
+  PROFILE_START(alloc);
+  DString *out = d_string_new(NULL);
+
+  if ((out != NULL) && d_string_reserve(out, size)) {
+    rows = d_string_append_space(out, size);
+  }
+  PROFILE_STOP(alloc, SHAMIR_PHASE_ALLOC);
+
+  if ((rows == NULL) || !write_share_strings(secret, len, n, t, rows)) {
+    d_string_free(out, true);
+    return NULL;
+  }
+
+  return d_string_take(out, NULL);
+}
+
+/*
+        generate_share_strings() -- create a string of the list of the generated
+   shares, one per line
+
+        The lines are written straight into one DString, presized to the exact
+        length of the result, so its buffer can be handed over as it is
+        (`share_strings_size() + 1` bytes, for shamir_free()).
+*/
+
+char *generate_share_strings(char *secret, int n, int t) {
+  if ((secret == NULL) || (n < 1) || (n > 255) || (t < 1) || (t > n)) {
+    return NULL;
+  }
+
+  return generate_lines(secret, strlen(secret), n, t);
+}
+
+/*
+        generate_share_strings_codec() -- generate_share_strings() for `len`
+                bytes, compressed with `codec` first if that makes them smaller
+*/
+
+char *generate_share_strings_codec(const char *secret, size_t len, int n, int t,
+                                   enum shamir_codec codec) {
+  if ((secret == NULL && len > 0) || (n < 1) || (n > 255) || (t < 1) ||
+      (t > n)) {
+    return NULL;
+  }
+
+  size_t packed_size = shamir_compress_bound(len);
+  size_t payload_len = 0;
+  char *packed = NULL;
+
+  if (codec != SHAMIR_CODEC_NONE) {
+    PROFILE_START(alloc);
+    packed = lib_malloc(packed_size);
+    PROFILE_STOP(alloc, SHAMIR_PHASE_ALLOC);
+
+    if (packed != NULL) {
+      payload_len = shamir_compress(codec, secret, len, packed);
+    }
+  }
+
+  if (payload_len == 0) {
+    codec = SHAMIR_CODEC_NONE;
+  }
+
+  char *shares = (codec == SHAMIR_CODEC_NONE)
+                     ? generate_lines(secret, len, n, t)
+                     : generate_lines(packed, payload_len, n, t);
+
+  if ((shares != NULL) && (codec != SHAMIR_CODEC_NONE)) {
+    size_t stride = 6 + 2 * payload_len + 1;
+    int i;
+
+    for (i = 0; i < n; ++i) {
+      share_set_codec(shares + i * stride, codec);
+    }
+  }
+
+  if (packed != NULL) {
+    lib_free(packed, packed_size);
+  }
+
+  return shares;
+}
+
+#ifdef TEST
+void Test_share_codec(CuTest *tc) {
+  char record[400] = "";
+  size_t len;
+  int i;
+
+  for (i = 0; i < 8; ++i) {
+    strcat(record, "{\"user\": \"someone\", \"role\": \"reader\"},");
+  }
+
+  char *shares = generate_share_strings_codec(record, strlen(record), 5, 3,
+                                              SHAMIR_CODEC_LZ4);
+
+  size_t stride = strchr(shares, '\n') - shares + 1;
+
+  /* Every line says LZ4, and they are shorter than the uncompressed ones */
+  CuAssertIntEquals(tc, SHAMIR_CODEC_LZ4, share_codec(shares));
+  CuAssertIntEquals(tc, SHAMIR_CODEC_LZ4, share_codec(shares + 4 * stride));
+  CuAssertTrue(tc, strlen(shares) < share_strings_size(strlen(record), 5) / 2);
+
+  /* Any three of them, decompressed after the join */
+  char *secret = extract_secret_from_share_strings_len(shares + stride, &len);
+
+  CuAssertIntEquals(tc, (int)strlen(record), (int)len);
+  CuAssertStrEquals(tc, record, secret);
+  free(secret);
+
+  /* Lines that disagree on the codec */
+  share_set_codec(shares + stride, SHAMIR_CODEC_NONE);
+  CuAssertPtrEquals(tc, NULL, extract_secret_from_share_strings(shares));
+  free(shares);
+
+  /* Too short to compress, stored as it is, zero bytes and all */
+  shares = generate_share_strings_codec("a\0b", 3, 3, 2, SHAMIR_CODEC_LZ4);
+  CuAssertIntEquals(tc, SHAMIR_CODEC_NONE, share_codec(shares));
+
+  secret = extract_secret_from_share_strings_len(shares, &len);
+  CuAssertIntEquals(tc, 3, (int)len);
+  CuAssertIntEquals(tc, 0, memcmp(secret, "a\0b", 3));
+  free(secret);
+  free(shares);
+
+  /* A payload that lies about its size */
+  char payload[512];
+  size_t size = shamir_compress(SHAMIR_CODEC_LZ4, record, strlen(record), payload);
+
+  CuAssertTrue(tc, size > 0 && size < sizeof(payload));
+  CuAssertIntEquals(tc, 0, shamir_decompress(SHAMIR_CODEC_LZ4, payload, size,
+                                             record, strlen(record) - 1));
+
+  /* One that claims more than its block could ever expand to */
+  payload[0] = payload[1] = payload[2] = payload[3] = (char)0xFF;
+  CuAssertTrue(tc, shamir_decompressed_size(SHAMIR_CODEC_LZ4, payload, size) ==
+                       (size_t)-1);
+
+  /* ... split and joined: refused before anything is allocated for it */
+  struct shamir_alloc_stats stats;
+
+  shares = generate_share_strings_codec(payload, size, 3, 2, SHAMIR_CODEC_NONE);
+  stride = strchr(shares, '\n') - shares + 1;
+
+  for (i = 0; i < 3; ++i) {
+    share_set_codec(shares + i * stride, SHAMIR_CODEC_LZ4);
+  }
+
+  shamir_alloc_stats_reset();
+  CuAssertPtrEquals(tc, NULL, extract_secret_from_share_strings_len(shares, &len));
+  shamir_alloc_stats_get(&stats);
+  CuAssertTrue(tc, stats.peak_bytes < 4096);
+  free(shares);
+}
+#endif
+
+/*
+        parse_share_strings() -- find the share lines in `size` bytes of
+                `string` without copying them
+
+        Each line is located with memchr(), which the C library vectorises,
+        and its trailing whitespace (' ', '\t', '\r') is stepped over in place,
+        so the input is read once and never written.  Blank lines are skipped.
+        Up to `max` views are filled in, but every line is counted, so a caller
+        can size an array from the return value and parse again.
+*/
+
+static int is_trailing_space(char c) {
+  return (c == ' ') || (c == '\t') || (c == '\r');
+}
+
+int parse_share_strings(const char *string, size_t size,
+                        struct share_view *views, int max) {
+  const char *end = string + size;
+  int count = 0;
+
+  while (string < end) {
+    const char *line_end = memchr(string, '\n', end - string);
+    const char *next = (line_end != NULL) ? line_end + 1 : end;
+
+    if (line_end == NULL) {
+      line_end = end;
+    }
+
+    while ((line_end > string) && is_trailing_space(line_end[-1])) {
+      --line_end;
+    }
+
+    if (line_end > string) {
+      if (count < max) {
+        views[count].data = string;
+        views[count].len = line_end - string;
+      }
+
+      ++count;
+    }
+
+    string = next;
+  }
+
+  return count;
+}
+
+/*
+        join_share_views() -- join_strings() for shares that are views into
+                a larger buffer
+
+        The secret's length comes from the first share, and every other share
+        must be at least as long, so nothing past a view is ever read.
+*/
+
+char *join_share_views(const struct share_view *views, int n) {
+  if ((n < 1) || (n > 255) || (views == NULL) || (views[0].len < 6)) {
+    return NULL;
+  }
+
+  const char *rows[n];
+  size_t len = (views[0].len - 6) / 2;
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    if ((views[i].data == NULL) || (views[i].len < 6 + 2 * len)) {
+      return NULL;
+    }
+
+    rows[i] = views[i].data;
+  }
+
+  /* join_strings_range() only reads the shares */
+  return join_strings_range((char **)rows, n, 0, len);
+}
+
+/* Views kept on the stack by extract_payload() */
+#define EXTRACT_STACK_VIEWS 32
+
+/*
+        extract_payload() -- split a raw string into individual shares, join
+                them, and report the codec they were written with (NULL if the
+                shares disagree on it)
+*/
+
+static char *extract_payload(const char *string, size_t *len,
+                             enum shamir_codec *codec) {
+  struct share_view stack_views[EXTRACT_STACK_VIEWS];
+  struct share_view *views = stack_views;
+  char *payload = NULL;
+  int i;
+
+  if (string == NULL) {
+    return NULL;
+  }
+
+  size_t size = strlen(string);
+  int n = parse_share_strings(string, size, views, EXTRACT_STACK_VIEWS);
+
+  /* More lines than fit on the stack -- one allocation, and a second pass */
+  if (n > EXTRACT_STACK_VIEWS) {
+    PROFILE_START(alloc);
+    views = lib_malloc(sizeof(struct share_view) * n);
+    PROFILE_STOP(alloc, SHAMIR_PHASE_ALLOC);
+
+    if (views == NULL) {
+      return NULL;
+    }
+
+    parse_share_strings(string, size, views, n);
+  }
+
+  if ((n > 0) && (views[0].len >= 6)) {
+    *codec = share_codec(views[0].data);
+    *len = (views[0].len - 6) / 2;
+    payload = join_share_views(views, n);
+
+    /* join_share_views() has checked every share covers the header */
+    for (i = 1; (payload != NULL) && (i < n); ++i) {
+      if (share_codec(views[i].data) != (int)*codec) {
+        lib_free(payload, *len + 1);
+        payload = NULL;
+      }
+    }
+  }
+
+  if (views != stack_views) {
+    lib_free(views, sizeof(struct share_view) * n);
+  }
+
+  return payload;
+}
+
+/*
+        extract_secret_from_share_strings_len() -- get a raw string, tidy it up
+                into individual shares, extract the secret, and decompress it
+                if it was compressed; `*len` is set to its length
+*/
+
+char *extract_secret_from_share_strings_len(const char *string, size_t *len) {
+  enum shamir_codec codec;
+  size_t payload_len;
+  char *payload = extract_payload(string, &payload_len, &codec);
+
+  *len = 0;
+
+  if (payload == NULL) {
+    return NULL;
+  }
+
+  if (codec == SHAMIR_CODEC_NONE) {
+    *len = payload_len;
+    return payload;
+  }
+
+  size_t size = shamir_decompressed_size(codec, payload, payload_len);
+  char *secret = NULL;
+
+  if (size != (size_t)-1) {
+    PROFILE_START(alloc);
+    secret = lib_malloc(size + 1);
+    PROFILE_STOP(alloc, SHAMIR_PHASE_ALLOC);
+  }
+
+  if ((secret != NULL) &&
+      !shamir_decompress(codec, payload, payload_len, secret, size)) {
+    lib_free(secret, size + 1);
+    secret = NULL;
+  }
+
+  if (secret != NULL) {
+    secret[size] = '\0';
+    *len = size;
+  }
+
+  lib_free(payload, payload_len + 1);
+
+  return secret;
+}
+
+char *extract_secret_from_share_strings(const char *string) {
+  size_t len;
+
+  return extract_secret_from_share_strings_len(string, &len);
+}
+
+#ifdef TEST
+void Test_extract_secret_from_share_strings(CuTest *tc) {
+  char *shares =
+      "0103AAFEBDB7A3F114\n0203AA1F407C51B784\n0303AAD9F0B37DB8C3\n0403AA29CB5B"
+      "26F4D1\n0503AA11D2754D6AAE\n0603AA910400F21B5A\n0703AAA863FE1307D6\n0803"
+      "AA56EE6CB32E20\n0903AA9CA44CD0903A\n0A03AA79869E6A2C23\n";
+
+  char *secret = extract_secret_from_share_strings(shares);
+
+  CuAssertStrEquals(tc, "secret", secret);
+
+  free(secret);
+
+  /* CRLF line ends, trailing blanks, blank lines, no final newline */
+  shares =
+      "\r\n0103AAFEBDB7A3F114 \r\n\n  \t\n0A03AA79869E6A2C23\t\n"
+      "0503AA11D2754D6AAE";
+
+  secret = extract_secret_from_share_strings(shares);
+
+  CuAssertStrEquals(tc, "secret", secret);
+
+  free(secret);
+
+  /* More shares than fit on the stack */
+  char *many = generate_share_strings("a longer secret, in forty shares", 40, 40);
+
+  secret = extract_secret_from_share_strings(many);
+
+  CuAssertStrEquals(tc, "a longer secret, in forty shares", secret);
+
+  free(secret);
+  free(many);
+
+  CuAssertPtrEquals(tc, NULL, extract_secret_from_share_strings(""));
+  CuAssertPtrEquals(tc, NULL, extract_secret_from_share_strings(NULL));
+}
+
+void Test_parse_share_strings(CuTest *tc) {
+  const char *input = "0103AA01\n\n0203AA02  \n0303AA03\r\n";
+  struct share_view views[2];
+
+  CuAssertIntEquals(tc, 3, parse_share_strings(input, strlen(input), views, 2));
+  CuAssertPtrEquals(tc, (void *)input, (void *)views[0].data);
+  CuAssertIntEquals(tc, 8, (int)views[0].len);
+  CuAssertPtrEquals(tc, (void *)(input + 10), (void *)views[1].data);
+  CuAssertIntEquals(tc, 8, (int)views[1].len);
+
+  /* A share too short for the first share's secret */
+  views[1].len = 7;
+  CuAssertPtrEquals(tc, NULL, join_share_views(views, 2));
+
+  CuAssertIntEquals(tc, 0, parse_share_strings(input, 0, views, 2));
+}
+#endif
+
+/*
+        Share commitments
+
+        A node can check its own share against a commitment the dealer
+        publishes to every node, without asking anyone else.  Feldman and
+        Pedersen commitments put the coefficients in the exponent of a group
+        whose order is the field's, and in a group of order 257 discrete
+        logarithms take a few hundred steps: Feldman's would give the secret
+        away and Pedersen's would bind nothing.  The commitment is built from
+        hashes and random linear checks instead.
+
+        * Node x gets a proof line with its share: x, a nonce of 32 codons,
+          and r_c(x) for each of the SHAMIR_VSS_CHECKS checks, every r_c being
+          a random polynomial of degree t - 1.
+        * The commitment holds n and t, the SHA-256 of each node's proof line
+          and share, and for each check c the t coefficients of F_c = r_c +
+          sum_k w_ck f_k, where f_k is the polynomial of secret byte k.  The
+          nonce keeps colluding nodes from testing guesses at the secret
+          against the other nodes' digests, and r_c makes F_c uniform, so the
+          commitment tells nothing about the secret.
+        * The weights come from the hash of the digests (Fiat-Shamir), so they
+          are only known once the dealer is bound to every share.  They are
+          w_ck = a_c[k % 64] * b_c[k / 64]: 64 values of a_c per check, and one
+          hash per 64 bytes gives that row's b_c for every check.
+
+        Node x accepts if its digest matches and sum_k w_ck y_k + r_c(x) =
+        F_c(x) for every check.  If the accepted shares do not lie on
+        polynomials of degree t - 1, each check passes with probability at
+        most 2/257 (w_ck is a product of two random values), so all of them
+        with about 2^-112 per attempt at the weights.  A check costs one
+        multiply-add per byte, and verify_share_views() checks any number of
+        shares of one commitment in one pass over the weights.
+*/
+
+/* One hash of the seed gives one weight for each check */
+#if SHAMIR_VSS_CHECKS != SHA256_DIGEST_SIZE / 2
+  #error "SHAMIR_VSS_CHECKS must be SHA256_DIGEST_SIZE / 2"
+#endif
+
+/* Bytes per row of weights: w_ck = a_c[k % VSS_ROW] * b_c[k / VSS_ROW] */
+#define VSS_ROW 64
+
+#define VSS_NONCE_CODONS 32
+
+/* Characters in a proof line, without its '\n' */
+#define VSS_PROOF_CHARS (2 + 2 * VSS_NONCE_CODONS + 2 * SHAMIR_VSS_CHECKS)
+
+/* The weights of one commitment */
+struct vss_challenge {
+  unsigned char seed[SHA256_DIGEST_SIZE];      // Hash of n, t and the digests
+  unsigned short a[SHAMIR_VSS_CHECKS][VSS_ROW];
+};
+
+/* Characters of a commitment before its checks: n, t and the digests */
+static size_t vss_digests_end(int n) { return 4 + 2 * SHA256_DIGEST_SIZE * n; }
+
+size_t share_commitment_size(int n, int t) {
+  return vss_digests_end(n) + 2 * SHAMIR_VSS_CHECKS * t + 1;
+}
+
+static void write_codon(char *out, int value) {
+  out[0] = codon_digits[value >> 4];
+  out[1] = codon_digits[value & 0xF];
+}
+
+/* Hex of the digest of `proof` (VSS_PROOF_CHARS) followed by `share` */
+static void vss_digest(const char *proof, const struct share_view *share,
+                       char *hex) {
+  unsigned char digest[SHA256_DIGEST_SIZE];
+  struct sha256 ctx;
+  int i;
+
+  sha256_init(&ctx);
+  sha256_update(&ctx, proof, VSS_PROOF_CHARS);
+  sha256_update(&ctx, share->data, share->len);
+  sha256_final(&ctx, digest);
+
+  for (i = 0; i < SHA256_DIGEST_SIZE; ++i) {
+    hex[2 * i] = codon_digits[digest[i] >> 4];
+    hex[2 * i + 1] = codon_digits[digest[i] & 0xF];
+  }
+}
+
+/* SHAMIR_VSS_CHECKS field elements from the hash of the seed, `label` and `index` */
+static void vss_expand(const unsigned char *seed, char label, uint64_t index,
+                       unsigned short *values) {
+  unsigned char input[SHA256_DIGEST_SIZE + 9];
+  unsigned char digest[SHA256_DIGEST_SIZE];
+  int i;
+
+  memcpy(input, seed, SHA256_DIGEST_SIZE);
+  input[SHA256_DIGEST_SIZE] = (unsigned char)label;
+
+  for (i = 0; i < 8; ++i) {
+    input[SHA256_DIGEST_SIZE + 1 + i] = (unsigned char)(index >> (8 * i));
+  }
+
+  sha256(input, sizeof(input), digest);
+
+  /* 65536 = 255 * 257 + 1, so 0 is only 2^-16 more likely than the rest */
+  for (i = 0; i < SHAMIR_VSS_CHECKS; ++i) {
+    values[i] = (digest[2 * i] | (digest[2 * i + 1] << 8)) % prime;
+  }
+}
+
+static void vss_challenge_init(struct vss_challenge *ch, const char *commitment,
+                               int n) {
+  int c;
+  int m;
+
+  sha256(commitment, vss_digests_end(n), ch->seed);
+
+  for (c = 0; c < SHAMIR_VSS_CHECKS; ++c) {
+    for (m = 0; m < VSS_ROW / SHAMIR_VSS_CHECKS; ++m) {
+      vss_expand(ch->seed, 'a', c * (VSS_ROW / SHAMIR_VSS_CHECKS) + m,
+                 ch->a[c] + m * SHAMIR_VSS_CHECKS);
+    }
+  }
+}
+
+/*
+        vss_combine() -- add sum_k w_ck y_k to `sums` (SHAMIR_VSS_CHECKS per
+                share) for the `count` shares that `use` marks (NULL: all)
+
+        Row by row over every share, so b_c is hashed once per row.  A row's
+        inner sum is at most 64 * 256 * 272 (a 'GG' codon), well within 32
+        bits, and is reduced once.
+*/
+
+static void vss_combine(const struct vss_challenge *ch,
+                        const struct share_view *shares,
+                        const unsigned char *use, int count,
+                        unsigned int *sums) {
+  size_t longest = 0;
+  uint64_t row;
+  int i;
+
+  for (i = 0; i < count; ++i) {
+    if (((use == NULL) || use[i]) && ((shares[i].len - 6) / 2 > longest)) {
+      longest = (shares[i].len - 6) / 2;
+    }
+  }
+
+  for (row = 0; row * VSS_ROW < longest; ++row) {
+    unsigned short b[SHAMIR_VSS_CHECKS];
+    size_t start = row * VSS_ROW;
+
+    vss_expand(ch->seed, 'b', row, b);
+
+    for (i = 0; i < count; ++i) {
+      size_t len = (shares[i].len - 6) / 2;
+
+      if (((use != NULL) && !use[i]) || (start >= len)) {
+        continue;
+      }
+
+      const char *codon = shares[i].data + 6 + 2 * start;
+      size_t block = len - start < VSS_ROW ? len - start : VSS_ROW;
+      unsigned short y[VSS_ROW];
+      unsigned int *sum = sums + i * SHAMIR_VSS_CHECKS;
+      size_t k;
+      int c;
+
+      for (k = 0; k < block; ++k) {
+        y[k] = decode_codon(codon + 2 * k);
+      }
+
+      for (c = 0; c < SHAMIR_VSS_CHECKS; ++c) {
+        unsigned int inner = 0;
+
+        for (k = 0; k < block; ++k) {
+          inner += ch->a[c][k] * y[k];
+        }
+
+        sum[c] = (sum[c] + b[c] * (inner % prime)) % prime;
+      }
+    }
+  }
+}
+
+/* p(x) for the `t` coefficients (lowest first) of a polynomial */
+static unsigned int evaluate_poly(const unsigned short *coef, int t, int x) {
+  unsigned int value = 0;
+  int i;
+
+  for (i = t - 1; i >= 0; --i) {
+    value = (value * x + coef[i]) % prime;
+  }
+
+  return value;
+}
+
+/*
+        vss_interpolate() -- the `t` coefficients of the polynomial through
+                (x, values[(x - 1) * stride]) for x = 1 - t, added to `coef`
+
+        With M(x) = (x - 1) ... (x - t), the basis polynomial of x = j is
+        M(x) / (x - j) divided by its own value at j, so one synthetic
+        division per point gives all its coefficients.  `work` holds 2t + 1
+        entries.
+*/
+
+static void vss_interpolate(const unsigned int *values, int stride, int t,
+                            unsigned short *coef, unsigned short *work) {
+  unsigned short *master = work;          // t + 1 coefficients of M
+  unsigned short *quotient = work + t + 1;
+  int i;
+  int j;
+
+  master[0] = 1;
+
+  for (j = 1; j <= t; ++j) {
+    master[j] = master[j - 1];
+
+    for (i = j - 1; i > 0; --i) {
+      master[i] = (master[i - 1] + (prime - j) * master[i]) % prime;
+    }
+
+    master[0] = (prime - j) * master[0] % prime;
+  }
+
+  for (j = 1; j <= t; ++j) {
+    quotient[t - 1] = master[t];
+
+    for (i = t - 1; i > 0; --i) {
+      quotient[i - 1] = (master[i] + j * quotient[i]) % prime;
+    }
+
+    unsigned int scale = values[(j - 1) * stride] *
+                         modInverse(evaluate_poly(quotient, t, j)) % prime;
+
+    for (i = 0; i < t; ++i) {
+      coef[i] = (coef[i] + scale * quotient[i]) % prime;
+    }
+  }
+}
+
+/*
+        commit_share_views() -- the commitment to the `n` shares of one split,
+                and each node's proof line
+*/
+
+char *commit_share_views(const struct share_view *views, int n, char **proofs) {
+  int i;
+  int c;
+
+  if ((views == NULL) || (proofs == NULL) || (n < 1) || (n > 255)) {
+    return NULL;
+  }
+
+  *proofs = NULL;
+
+  if ((views[0].data == NULL) || (views[0].len < 6) ||
+      ((views[0].len - 6) % 2 != 0)) {
+    return NULL;
+  }
+
+  int t = decode_codon(views[0].data + 2);
+
+  if ((t < 1) || (t > n)) {
+    return NULL;
+  }
+
+  /* Every share of the split, in order */
+  for (i = 0; i < n; ++i) {
+    if ((views[i].data == NULL) || (views[i].len != views[0].len) ||
+        (decode_codon(views[i].data) != i + 1) ||
+        (decode_codon(views[i].data + 2) != t)) {
+      return NULL;
+    }
+  }
+
+  size_t size = share_commitment_size(n, t);
+  size_t proofs_size = (size_t)n * (VSS_PROOF_CHARS + 1);
+  size_t check_count = (size_t)SHAMIR_VSS_CHECKS * t;
+  size_t drawn_count = check_count + (size_t)VSS_NONCE_CODONS * n;
+  size_t work_count = check_count + 2 * t + 1;
+
+  PROFILE_START(alloc);
+  char *commitment = lib_malloc(size + 1);
+  char *lines = lib_malloc(proofs_size + 1);
+  unsigned short *drawn = lib_malloc(sizeof(unsigned short) * drawn_count);
+  unsigned short *work = lib_malloc(sizeof(unsigned short) * work_count);
+  unsigned int *sums = lib_malloc(sizeof(unsigned int) * check_count);
+  struct vss_challenge *ch = lib_malloc(sizeof(struct vss_challenge));
+  PROFILE_STOP(alloc, SHAMIR_PHASE_ALLOC);
+
+  if ((commitment != NULL) && (lines != NULL) && (drawn != NULL) &&
+      (work != NULL) && (sums != NULL) && (ch != NULL)) {
+    unsigned short *blind = drawn;   // Coefficients of r_c, check-major
+    unsigned short *nonce = drawn + check_count;
+    unsigned short *coef = work;     // Coefficients of F_c, check-major
+
+    shamir_random_coefficients(drawn, drawn_count);
+
+    for (i = 0; i < n; ++i) {
+      char *line = lines + i * (VSS_PROOF_CHARS + 1);
+      int m;
+
+      write_codon(line, i + 1);
+
+      for (m = 0; m < VSS_NONCE_CODONS; ++m) {
+        write_codon(line + 2 + 2 * m, nonce[i * VSS_NONCE_CODONS + m]);
+      }
+
+      for (c = 0; c < SHAMIR_VSS_CHECKS; ++c) {
+        write_codon(line + 2 + 2 * VSS_NONCE_CODONS + 2 * c,
+                    evaluate_poly(blind + c * t, t, i + 1));
+      }
+
+      line[VSS_PROOF_CHARS] = '\n';
+    }
+
+    lines[proofs_size] = '\0';
+
+    write_codon(commitment, n);
+    write_codon(commitment + 2, t);
+
+    for (i = 0; i < n; ++i) {
+      vss_digest(lines + i * (VSS_PROOF_CHARS + 1), &views[i],
+                 commitment + 4 + 2 * SHA256_DIGEST_SIZE * i);
+    }
+
+    vss_challenge_init(ch, commitment, n);
+
+    /* Shares 1 - t fix the polynomials */
+    memset(sums, 0, sizeof(unsigned int) * check_count);
+    vss_combine(ch, views, NULL, t, sums);
+
+    memcpy(coef, blind, sizeof(unsigned short) * check_count);
+
+    for (c = 0; c < SHAMIR_VSS_CHECKS; ++c) {
+      vss_interpolate(sums + c, SHAMIR_VSS_CHECKS, t, coef + c * t,
+                      work + check_count);
+    }
+
+    for (i = 0; i < (int)check_count; ++i) {
+      write_codon(commitment + vss_digests_end(n) + 2 * i, coef[i]);
+    }
+
+    commitment[size - 1] = '\n';
+    commitment[size] = '\0';
+
+    *proofs = lines;
+    lines = NULL;
+  } else if (commitment != NULL) {
+    lib_free(commitment, size + 1);
+    commitment = NULL;
+  }
+
+  PROFILE_START(release);
+  /* Reverse order, so an arena can pop them */
+  lib_free(ch, sizeof(struct vss_challenge));
+  lib_free(sums, sizeof(unsigned int) * check_count);
+  lib_free(work, sizeof(unsigned short) * work_count);
+  lib_free(drawn, sizeof(unsigned short) * drawn_count);
+  lib_free(lines, proofs_size + 1);
+  PROFILE_STOP(release, SHAMIR_PHASE_ALLOC);
+
+  return commitment;
+}
+
+/*
+        verify_share_views() -- check `count` shares and their proof lines
+                against one commitment
+*/
+
+int verify_share_views(const char *commitment, const struct share_view *shares,
+                       const struct share_view *proofs, int count,
+                       unsigned char *valid) {
+  int passed = 0;
+  int i;
+  int c;
+
+  if ((commitment == NULL) || (count < 0) ||
+      ((count > 0) && ((shares == NULL) || (proofs == NULL) || (valid == NULL)))) {
+    return -1;
+  }
+
+  if (count > 0) {
+    memset(valid, 0, count);
+  }
+
+  size_t size = strlen(commitment);
+
+  while ((size > 0) && (is_trailing_space(commitment[size - 1]) ||
+                        (commitment[size - 1] == '\n'))) {
+    --size;
+  }
+
+  if (size < 4) {
+    return -1;
+  }
+
+  int n = decode_codon(commitment);
+  int t = decode_codon(commitment + 2);
+
+  if ((n < 1) || (n > 255) || (t < 1) || (t > n) ||
+      (size != share_commitment_size(n, t) - 1)) {
+    return -1;
+  }
+
+  if (count == 0) {
+    return 0;
+  }
+
+  /* Shares whose digest matches go on to the checks */
+  for (i = 0; i < count; ++i) {
+    const struct share_view *share = &shares[i];
+    const struct share_view *proof = &proofs[i];
+    char hex[2 * SHA256_DIGEST_SIZE];
+
+    if ((share->data == NULL) || (proof->data == NULL) || (share->len < 6) ||
+        ((share->len - 6) % 2 != 0) || (proof->len != VSS_PROOF_CHARS)) {
+      continue;
+    }
+
+    int x = decode_codon(share->data);
+
+    if ((x < 1) || (x > n) || (decode_codon(proof->data) != x) ||
+        (decode_codon(share->data + 2) != t)) {
+      continue;
+    }
+
+    vss_digest(proof->data, share, hex);
+
+    valid[i] = memcmp(hex, commitment + 4 + 2 * SHA256_DIGEST_SIZE * (x - 1),
+                      sizeof(hex)) == 0;
+  }
+
+  PROFILE_START(alloc);
+  struct vss_challenge *ch = lib_malloc(sizeof(struct vss_challenge));
+  unsigned int *sums = lib_calloc((size_t)count * SHAMIR_VSS_CHECKS,
+                                  sizeof(unsigned int));
+  unsigned short *coef = lib_malloc(sizeof(unsigned short) * t);
+  PROFILE_STOP(alloc, SHAMIR_PHASE_ALLOC);
+
+  if ((ch != NULL) && (sums != NULL) && (coef != NULL)) {
+    const char *checks = commitment + vss_digests_end(n);
+
+    vss_challenge_init(ch, commitment, n);
+    vss_combine(ch, shares, valid, count, sums);
+
+    for (c = 0; c < SHAMIR_VSS_CHECKS; ++c) {
+      int k;
+
+      for (k = 0; k < t; ++k) {
+        coef[k] = decode_codon(checks + 2 * (c * t + k)) % prime;
+      }
+
+      for (i = 0; i < count; ++i) {
+        if (valid[i]) {
+          const char *r = proofs[i].data + 2 + 2 * VSS_NONCE_CODONS + 2 * c;
+          unsigned int lhs = (sums[i * SHAMIR_VSS_CHECKS + c] + decode_codon(r)) % prime;
+
+          valid[i] = lhs == evaluate_poly(coef, t, decode_codon(shares[i].data));
+        }
+      }
+    }
+
+    for (i = 0; i < count; ++i) {
+      passed += valid[i];
+    }
+  } else {
+    memset(valid, 0, count);
+    passed = -1;
+  }
+
+  PROFILE_START(release);
+  lib_free(coef, sizeof(unsigned short) * t);
+  lib_free(sums, sizeof(unsigned int) * count * SHAMIR_VSS_CHECKS);
+  lib_free(ch, sizeof(struct vss_challenge));
+  PROFILE_STOP(release, SHAMIR_PHASE_ALLOC);
+
+  return passed;
+}
+
+int verify_share_string(const char *commitment, const char *share,
+                        const char *proof) {
+  struct share_view share_view;
+  struct share_view proof_view;
+  unsigned char valid;
+
+  if ((share == NULL) || (proof == NULL) ||
+      (parse_share_strings(share, strlen(share), &share_view, 1) < 1) ||
+      (parse_share_strings(proof, strlen(proof), &proof_view, 1) < 1)) {
+    return 0;
+  }
+
+  return verify_share_views(commitment, &share_view, &proof_view, 1, &valid) == 1;
+}
+
+#ifdef TEST
+void Test_share_commitments(CuTest *tc) {
+  const char *secret =
+      "a secret long enough for two rows of weights, and then some more of "
+      "it, so the last row is a partial one";
+  struct share_view shares[7];
+  struct share_view proofs[7];
+  unsigned char valid[7];
+  char *proof_lines;
+  int i;
+
+  char *lines = generate_share_strings((char *)secret, 7, 4);
+
+  CuAssertIntEquals(tc, 7, parse_share_strings(lines, strlen(lines), shares, 7));
+
+  char *commitment = commit_share_views(shares, 7, &proof_lines);
+
+  CuAssertPtrNotNull(tc, commitment);
+  CuAssertIntEquals(tc, (int)share_commitment_size(7, 4), (int)strlen(commitment));
+  CuAssertIntEquals(tc, 7, parse_share_strings(proof_lines, strlen(proof_lines), proofs, 7));
+  CuAssertIntEquals(tc, 7, verify_share_views(commitment, shares, proofs, 7, valid));
+
+  /* One node, with its own lines as NUL-terminated strings */
+  char share[512];
+  char proof[128];
+
+  memcpy(share, shares[2].data, shares[2].len);
+  share[shares[2].len] = '\0';
+  memcpy(proof, proofs[2].data, proofs[2].len);
+  proof[proofs[2].len] = '\0';
+  CuAssertIntEquals(tc, 1, verify_share_string(commitment, share, proof));
+
+  /* Another node's proof, or a share changed in transit */
+  CuAssertIntEquals(tc, 0, verify_share_string(commitment, share, proof_lines));
+  share[40] = (share[40] == '0') ? '1' : '0';
+  CuAssertIntEquals(tc, 0, verify_share_string(commitment, share, proof));
+
+  /* A dealer that commits to a share off the polynomials: its digest
+     matches, the checks do not */
+  char *bad = (char *)shares[5].data;
+
+  bad[100] = (bad[100] == '0') ? '1' : '0';
+  free(commitment);
+  free(proof_lines);
+  commitment = commit_share_views(shares, 7, &proof_lines);
+  parse_share_strings(proof_lines, strlen(proof_lines), proofs, 7);
+
+  CuAssertIntEquals(tc, 6, verify_share_views(commitment, shares, proofs, 7, valid));
+  CuAssertIntEquals(tc, 0, valid[5]);
+
+  for (i = 0; i < 7; ++i) {
+    if (i != 5) {
+      CuAssertIntEquals(tc, 1, valid[i]);
+    }
+  }
+
+  /* Malformed commitments, and shares out of order */
+  CuAssertIntEquals(tc, -1, verify_share_views("0704", shares, proofs, 7, valid));
+  commitment[strlen(commitment) - 2] = '\0';
+  CuAssertIntEquals(tc, -1, verify_share_views(commitment, shares, proofs, 7, valid));
+
+  free(commitment);
+  free(proof_lines);
+
+  CuAssertPtrEquals(tc, NULL, commit_share_views(shares + 1, 6, &proof_lines));
+  CuAssertPtrEquals(tc, NULL, proof_lines);
+
+  free(lines);
+
+  /* A single share, and an empty secret */
+  lines = generate_share_strings("x", 1, 1);
+  parse_share_strings(lines, strlen(lines), shares, 1);
+  commitment = commit_share_views(shares, 1, &proof_lines);
+  CuAssertIntEquals(tc, 1, verify_share_string(commitment, lines, proof_lines));
+
+  free(commitment);
+  free(proof_lines);
+  free(lines);
+
+  shares[0].data = "0102AA";
+  shares[0].len = 6;
+  shares[1].data = "0202AA";
+  shares[1].len = 6;
+  commitment = commit_share_views(shares, 2, &proof_lines);
+  CuAssertIntEquals(tc, 1, verify_share_string(commitment, "0202AA", proof_lines + 99));
+
+  free(commitment);
+  free(proof_lines);
+}
+#endif
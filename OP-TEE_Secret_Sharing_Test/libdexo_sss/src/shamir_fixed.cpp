@@ -0,0 +1,179 @@
+/*
+        shamir_fixed.cpp -- C entry points to the specialised kernels
+
+        One instance of fixed_scheme per committee shape in `shapes` below, and
+        a join per distinct threshold.  Calls are dispatched by a linear search
+        of those tables; anything else returns -1.
+*/
+
+#include <stddef.h>
+
+#include "shamir_fixed.h"
+#include "shamir_fixed.hpp"
+#include "shamir_private.h"
+
+#ifdef TEST
+#include <stdlib.h>
+#include <string.h>
+
+extern "C" {
+#include "shamir.h"
+}
+#endif
+
+namespace {
+
+using dexo_sss::fixed_scheme;
+using dexo_sss::gf257;
+
+struct shape {
+	int n;
+	int t;
+	void (*split)(const unsigned char *, size_t, char *);
+};
+
+struct library_random {
+	void operator()(unsigned short *coef, size_t count) const {
+		shamir_random_coefficients(coef, count);
+	}
+};
+
+template <int N, int T>
+void split_fixed(const unsigned char *secret, size_t len, char *buffer) {
+	fixed_scheme<gf257, N, T>::split(secret, len, buffer, library_random());
+}
+
+/* n = 5 - 50 with t = ceil(2n/3) and ceil(n/2), as in the host benchmark */
+const shape shapes[] = {
+	{5, 4, split_fixed<5, 4>},    {5, 3, split_fixed<5, 3>},
+	{10, 7, split_fixed<10, 7>},  {10, 5, split_fixed<10, 5>},
+	{20, 14, split_fixed<20, 14>}, {20, 10, split_fixed<20, 10>},
+	{30, 20, split_fixed<30, 20>}, {30, 15, split_fixed<30, 15>},
+	{40, 27, split_fixed<40, 27>}, {40, 20, split_fixed<40, 20>},
+	{50, 34, split_fixed<50, 34>}, {50, 25, split_fixed<50, 25>},
+};
+
+struct join_shape {
+	int t;
+	bool (*join)(const char *const *, size_t, size_t, unsigned char *);
+};
+
+/* Joining only depends on how many shares are used; N does not matter */
+template <int T>
+bool join_fixed(const char *const *shares, size_t offset, size_t length, unsigned char *result) {
+	return fixed_scheme<gf257, T, T>::join(shares, offset, length, result);
+}
+
+const join_shape join_shapes[] = {
+	{3, join_fixed<3>},   {4, join_fixed<4>},   {5, join_fixed<5>},
+	{7, join_fixed<7>},   {10, join_fixed<10>}, {14, join_fixed<14>},
+	{15, join_fixed<15>}, {20, join_fixed<20>}, {25, join_fixed<25>},
+	{27, join_fixed<27>}, {34, join_fixed<34>},
+};
+
+const shape *find_shape(int n, int t) {
+	for (const shape &s : shapes) {
+		if ((s.n == n) && (s.t == t)) {
+			return &s;
+		}
+	}
+
+	return nullptr;
+}
+
+}  // namespace
+
+int shamir_fixed_supported(int n, int t) { return find_shape(n, t) != nullptr; }
+
+int write_share_strings_fixed(const char *secret, size_t len, int n, int t, char *buffer) {
+	const shape *s = find_shape(n, t);
+
+	if (s == nullptr) {
+		return -1;
+	}
+
+	if (((secret == nullptr) && (len > 0)) || (buffer == nullptr)) {
+		return 0;
+	}
+
+	s->split(reinterpret_cast<const unsigned char *>(secret), len, buffer);
+
+	return 1;
+}
+
+int join_strings_range_into_fixed(char **shares, int n, size_t offset, size_t length, char *result) {
+	for (const join_shape &s : join_shapes) {
+		if (s.t != n) {
+			continue;
+		}
+
+		if ((shares == nullptr) || (result == nullptr)) {
+			return 0;
+		}
+
+		for (int i = 0; i < n; ++i) {
+			if (shares[i] == nullptr) {
+				return 0;
+			}
+		}
+
+		return s.join(shares, offset, length, reinterpret_cast<unsigned char *>(result));
+	}
+
+	return -1;
+}
+
+#ifdef TEST
+extern "C" void Test_shamir_fixed(CuTest *tc) {
+	char secret[1000];
+	size_t size = share_strings_size(sizeof(secret), 50);
+	char *fixed = static_cast<char *>(malloc(size));
+	char *rows[50];
+	char fast[1000];
+	char generic[1000];
+
+	for (size_t i = 0; i < sizeof(secret); ++i) {
+		secret[i] = static_cast<char>(i * 7);
+	}
+
+	CuAssertIntEquals(tc, 1, write_share_strings_fixed(secret, sizeof(secret), 50, 34, fixed));
+
+	/* Last 34 shares, then the first 34: the generic join must agree */
+	for (int i = 0; i < 34; ++i) {
+		rows[i] = fixed + (size / 50) * (49 - i);
+	}
+
+	CuAssertIntEquals(tc, 1, join_strings_range_into_fixed(rows, 34, 0, sizeof(secret), fast));
+	CuAssertIntEquals(tc, 1, join_strings_range_into(rows, 34, 0, sizeof(secret), generic));
+	CuAssertIntEquals(tc, 0, memcmp(secret, fast, sizeof(secret)));
+	CuAssertIntEquals(tc, 0, memcmp(secret, generic, sizeof(secret)));
+
+	for (int i = 0; i < 34; ++i) {
+		rows[i] = fixed + (size / 50) * i;
+	}
+
+	CuAssertIntEquals(tc, 1, join_strings_range_into_fixed(rows, 34, 100, 50, fast));
+	CuAssertIntEquals(tc, 0, memcmp(secret + 100, fast, 50));
+
+	/* The generic split's shares join through the fixed path too */
+	CuAssertIntEquals(tc, 1, write_share_strings(secret, sizeof(secret), 10, 7, fixed));
+
+	for (int i = 0; i < 7; ++i) {
+		rows[i] = fixed + (6 + 2 * sizeof(secret) + 1) * (i + 2);
+	}
+
+	CuAssertIntEquals(tc, 1, join_strings_range_into_fixed(rows, 7, 0, sizeof(secret), fast));
+	CuAssertIntEquals(tc, 0, memcmp(secret, fast, sizeof(secret)));
+
+	/* Headers match the generic layout */
+	CuAssertIntEquals(tc, 0, memcmp(fixed + (6 + 2 * sizeof(secret) + 1) * 9, "0A07AA", 6));
+
+	CuAssertIntEquals(tc, -1, write_share_strings_fixed(secret, sizeof(secret), 6, 4, fixed));
+	CuAssertIntEquals(tc, -1, join_strings_range_into_fixed(rows, 6, 0, 1, fast));
+
+	rows[1] = rows[0];
+	CuAssertIntEquals(tc, 0, join_strings_range_into_fixed(rows, 7, 0, 1, fast));
+
+	free(fixed);
+}
+#endif
@@ -0,0 +1,22 @@
+#ifndef SHAMIR_PRIVATE_H
+#define SHAMIR_PRIVATE_H
+
+#include <stddef.h>
+
+/* Library internals shared by shamir.c and the C++ kernels (shamir_fixed.cpp) */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Allocate through the library's allocator; release with shamir_free() */
+void *shamir_alloc(size_t size);
+
+/* Fill `count` polynomial coefficients from the library's random source */
+void shamir_random_coefficients(unsigned short *coef, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,42 @@
+global-incdirs-y += include
+srcs-y += src/shamir.c
+srcs-y += src/strtok.c
+srcs-y += src/d_string.c
+srcs-y += src/lz4_block.c
+srcs-y += src/sha256.c
+# src/shamir_fixed.cpp (C++17) is left to the host build
+
+# Built with the TA dev kit: draw coefficients from the TEE RNG
+cflags-y += -DSHAMIR_TA
+
+# Field the shares are computed in. GF(257) is the only one the share
+# format can carry.
+CFG_DEXO_SSS_FIELD ?= gf257
+ifneq ($(CFG_DEXO_SSS_FIELD),gf257)
+$(error libdexo_sss: unsupported field '$(CFG_DEXO_SSS_FIELD)')
+endif
+cflags-y += -DDEXO_SSS_FIELD_GF257
+
+# SIMD level of the split and join kernels: none or neon (needs
+# CFG_TA_FLOAT_SUPPORT=y, as the kernels then use the vector registers)
+CFG_DEXO_SSS_SIMD ?= none
+ifeq ($(CFG_DEXO_SSS_SIMD),none)
+cflags-y += -DDEXO_SSS_SIMD_NONE -fno-tree-vectorize
+else ifeq ($(CFG_DEXO_SSS_SIMD),neon)
+cflags-y += -DDEXO_SSS_SIMD_NEON -O3 -ftree-vectorize
+else
+$(error libdexo_sss: unsupported SIMD level '$(CFG_DEXO_SSS_SIMD)')
+endif
+
+# Per-phase timing of the split and join paths. Off by default, as the
+# clock is read inside the split and join loops.
+ifeq ($(CFG_DEXO_SSS_PROFILE),y)
+cflags-y += -DSHAMIR_PROFILE
+# Time with the generic timer's virtual counter, which needs EL0 access to
+# it. CFG_DEXO_SSS_CNTVCT=n falls back to TEE_GetSystemTime(), whose 1 ms
+# resolution rounds nearly every per-tile interval to 0.
+CFG_DEXO_SSS_CNTVCT ?= y
+ifeq ($(CFG_DEXO_SSS_CNTVCT),y)
+cflags-y += -DSHAMIR_PROFILE_CNTVCT
+endif
+endif
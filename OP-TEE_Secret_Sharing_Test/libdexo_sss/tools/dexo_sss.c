@@ -0,0 +1,411 @@
+/*
+ * dexo-sss: split a file into n share files, or join t of them back, with
+ * libdexo_sss.  Files of any content and size; everything is mmap()ed, so
+ * nothing is read into or written from a heap buffer.
+ *
+ * A share file is one share line in the usual format (the 6 character header,
+ * two characters per byte of the file, '\n'), the same as one line of
+ * generate_share_strings(), so it can also be joined with
+ * extract_secret_from_share_strings() or the Python binding.
+ */
+
+#define _GNU_SOURCE
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "shamir.h"
+
+/* Bytes of the file split or joined per library call */
+static size_t chunk_size = 1 << 20;
+
+/* Threads splitting at once (0 = one per online CPU) */
+static long thread_count = 0;
+
+/* Codec the input is compressed with before it is split (-z) */
+static enum shamir_codec split_codec = SHAMIR_CODEC_NONE;
+
+static size_t parse_size(const char *arg) {
+  char *end;
+  size_t value = strtoull(arg, &end, 10);
+
+  switch (*end) {
+    case 'G': value *= 1024;
+    /* fall through */
+    case 'M': value *= 1024;
+    /* fall through */
+    case 'K': value *= 1024;
+  }
+  return value;
+}
+
+/* Map all of `path` read-only; *len is its size (an empty file maps to NULL) */
+static const char *map_input(const char *path, size_t *len) {
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+
+  if (fd < 0) err(1, "Cannot open %s", path);
+  if (fstat(fd, &st) < 0) err(1, "Cannot stat %s", path);
+
+  *len = st.st_size;
+  if (*len == 0) {
+    close(fd);
+    return NULL;
+  }
+
+  const char *map = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED) err(1, "Cannot map %s", path);
+  madvise((void *)map, *len, MADV_SEQUENTIAL);
+  close(fd);
+
+  return map;
+}
+
+/*
+ * Size the file open on `fd` (called `path`) to `size` bytes and map it
+ * writable at `at` (or anywhere if NULL; an empty file is not mapped).  The
+ * blocks are allocated up front where the file system can, so a full disk is
+ * an error here rather than a SIGBUS in the middle of a split.
+ */
+static char *map_output_fd(int fd, const char *path, size_t size, char *at) {
+  /* EINVAL for an empty file, or from file systems that cannot */
+  int rc = posix_fallocate(fd, 0, size);
+  if (rc == EOPNOTSUPP || rc == EINVAL) rc = ftruncate(fd, size) ? errno : 0;
+  if (rc) {
+    errno = rc;
+    err(1, "Cannot size %s", path);
+  }
+
+  if (size == 0) {
+    close(fd);
+    return NULL;
+  }
+
+  char *map = mmap(at, size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | (at ? MAP_FIXED : 0), fd, 0);
+  if (map == MAP_FAILED) err(1, "Cannot map %s", path);
+  close(fd);
+
+  return map;
+}
+
+/* Create `path` with `size` bytes and map it as map_output_fd() does */
+static char *map_output(const char *path, size_t size, char *at) {
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+
+  if (fd < 0) err(1, "Cannot create %s", path);
+
+  return map_output_fd(fd, path, size, at);
+}
+
+/*
+ * A join writes into a temporary file next to its output, renamed over the
+ * output only once the secret is complete, and removed if dexo-sss exits
+ * before that.  Wrong or forged shares leave no partial file behind.
+ */
+static char *partial_path = NULL;
+
+static void remove_partial_output(void) {
+  if (partial_path) unlink(partial_path);
+}
+
+static char *map_partial_output(const char *path, size_t size) {
+  partial_path = malloc(strlen(path) + sizeof(".XXXXXX"));
+  if (!partial_path) errx(1, "Out of memory");
+
+  sprintf(partial_path, "%s.XXXXXX", path);
+
+  int fd = mkstemp(partial_path);
+  if (fd < 0) err(1, "Cannot create a file next to %s", path);
+
+  atexit(remove_partial_output);
+  return map_output_fd(fd, partial_path, size, NULL);
+}
+
+static void commit_output(const char *path) {
+  if (rename(partial_path, path) != 0)
+    err(1, "Cannot rename %s to %s", partial_path, path);
+
+  free(partial_path);
+  partial_path = NULL;
+}
+
+/* One thread of a split: bytes [start, end) of the input, with its own stream */
+struct split_worker {
+  pthread_t thread;
+  int n;
+  int t;
+  const char *input;
+  size_t start;
+  size_t end;
+  char *rows;         //!< Codons of byte 0 of share 1; share j is `slot` bytes on
+  size_t slot;
+};
+
+static void *split_worker_main(void *arg) {
+  struct split_worker *w = arg;
+  struct split_stream *stream = split_stream_new(w->n, w->t);
+
+  if (!stream) errx(1, "Out of memory");
+
+  for (size_t offset = w->start; offset < w->end; offset += chunk_size) {
+    size_t len = w->end - offset < chunk_size ? w->end - offset : chunk_size;
+
+    split_stream_feed(stream, w->input + offset, len, w->rows + 2 * offset,
+                      w->slot);
+  }
+
+  split_stream_free(stream);
+  return NULL;
+}
+
+/*
+ * The n share files are mapped side by side, `slot` (their size rounded up to
+ * a page) apart, into one reserved range.  To the library they are then the
+ * rows of one matrix, so split_stream_feed() writes every share straight
+ * into its file.  With -z the input is compressed into memory first, and that
+ * is what gets split.
+ */
+static int split_file(int n, int t, const char *input_path, const char *prefix) {
+  size_t file_len;
+  const char *file = map_input(input_path, &file_len);
+  const char *input = file;
+  size_t len = file_len;
+  char *packed = NULL;
+  enum shamir_codec codec = SHAMIR_CODEC_NONE;
+
+  if (split_codec != SHAMIR_CODEC_NONE) {
+    packed = malloc(shamir_compress_bound(file_len));
+    if (!packed) errx(1, "Out of memory");
+
+    size_t packed_len = shamir_compress(split_codec, file, file_len, packed);
+
+    /* Split as it is if it does not get smaller */
+    if (packed_len) {
+      input = packed;
+      len = packed_len;
+      codec = split_codec;
+    }
+  }
+
+  size_t size = share_strings_size(len, 1);
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t slot = (size + page - 1) / page * page;
+  char path[4096];
+
+  char *base = mmap(NULL, slot * n, PROT_NONE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (base == MAP_FAILED) err(1, "Cannot reserve %zu B of address space", slot * n);
+
+  struct split_stream *stream = split_stream_new(n, t);
+  if (!stream) errx(1, "Cannot split into %d shares with threshold %d", n, t);
+
+  for (int j = 0; j < n; j++) {
+    if (snprintf(path, sizeof(path), "%s.%d", prefix, j + 1) >= (int)sizeof(path))
+      errx(1, "Output name too long");
+
+    char *share = map_output(path, size, base + j * slot);
+
+    split_stream_header(stream, j + 1, share);
+    share_set_codec(share, codec);
+    share[size - 1] = '\n';
+  }
+
+  split_stream_free(stream);
+
+  /* Whole chunks per thread, and no more threads than chunks */
+  long threads = thread_count > 0 ? thread_count : sysconf(_SC_NPROCESSORS_ONLN);
+  size_t chunks = (len + chunk_size - 1) / chunk_size;
+
+  if (threads > (long)chunks) threads = chunks ? chunks : 1;
+
+  struct split_worker *workers = calloc(threads, sizeof(struct split_worker));
+  if (!workers) errx(1, "Out of memory");
+
+  for (long i = 0; i < threads; i++) {
+    struct split_worker *w = &workers[i];
+
+    w->n = n;
+    w->t = t;
+    w->input = input;
+    w->start = chunks * i / threads * chunk_size;
+    w->end = chunks * (i + 1) / threads * chunk_size;
+    if (w->end > len) w->end = len;
+    w->rows = base + 6;
+    w->slot = slot;
+
+    if (pthread_create(&w->thread, NULL, split_worker_main, w))
+      errx(1, "Cannot create thread");
+  }
+
+  for (long i = 0; i < threads; i++) pthread_join(workers[i].thread, NULL);
+
+  free(workers);
+  munmap(base, slot * n);
+  if (file) munmap((void *)file, file_len);
+  free(packed);
+
+  return 0;
+}
+
+static int hex_digit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'G') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'g') return c - 'a' + 10;
+  return -1;
+}
+
+/*
+ * Join the first t of `count` share files into `output_path`, t being what
+ * the shares' headers say.  The secret's bytes are written into the mapped
+ * output a chunk at a time, reading only the matching codons of each share.
+ * Compressed shares are joined into memory and decompressed into the output.
+ * Either way the output only appears once it is complete.
+ */
+static int join_files(int count, char **paths, const char *output_path) {
+  char **shares = calloc(count, sizeof(char *));
+  size_t *sizes = calloc(count, sizeof(size_t));
+  size_t len = 0;
+
+  if (!shares || !sizes) errx(1, "Out of memory");
+
+  for (int i = 0; i < count; i++) {
+    const char *share = map_input(paths[i], &sizes[i]);
+    size_t share_len = sizes[i];
+
+    /* The line without its trailing whitespace */
+    while (share_len > 0 && memchr(" \t\r\n", share[share_len - 1], 4)) share_len--;
+
+    if (share_len < 6 || (share_len - 6) % 2)
+      errx(1, "%s is not a share file", paths[i]);
+
+    if (i > 0 && (share_len - 6) / 2 != len)
+      errx(1, "%s is for a %zu B secret, %s for %zu B", paths[i],
+           (share_len - 6) / 2, paths[0], len);
+
+    len = (share_len - 6) / 2;
+    shares[i] = (char *)share;
+
+    if (share_codec(shares[i]) != share_codec(shares[0]))
+      errx(1, "%s and %s were not compressed the same way", paths[i], paths[0]);
+  }
+
+  int t = hex_digit(shares[0][2]) * 16 + hex_digit(shares[0][3]);
+
+  if (t < 1) errx(1, "%s has no threshold in its header", paths[0]);
+  if (count < t) errx(1, "The shares need %d of them to be joined, %d given", t, count);
+
+  enum shamir_codec codec = share_codec(shares[0]);
+  char *payload = codec == SHAMIR_CODEC_NONE
+                      ? map_partial_output(output_path, len)
+                      : malloc(len ? len : 1);
+
+  /* An empty output is not mapped */
+  if (!payload && codec != SHAMIR_CODEC_NONE) errx(1, "Out of memory");
+
+  for (size_t offset = 0; offset < len; offset += chunk_size) {
+    size_t block = len - offset < chunk_size ? len - offset : chunk_size;
+
+    if (!join_strings_range_into(shares, t, offset, block, payload + offset))
+      errx(1, "The shares cannot be joined (repeated or bad share numbers)");
+  }
+
+  if (codec == SHAMIR_CODEC_NONE) {
+    if (len) munmap(payload, len);
+  } else {
+    size_t size = shamir_decompressed_size(codec, payload, len);
+
+    /* The size is bounded by what the payload can expand to */
+    if (size == (size_t)-1) errx(1, "The shares hold no compressed secret");
+
+    char *output = map_partial_output(output_path, size);
+
+    if (!shamir_decompress(codec, payload, len, output, size))
+      errx(1, "The joined secret does not decompress (wrong or corrupt shares)");
+
+    if (output) munmap(output, size);
+    free(payload);
+  }
+
+  commit_output(output_path);
+
+  for (int i = 0; i < count; i++) munmap(shares[i], sizes[i]);
+
+  free(sizes);
+  free(shares);
+  return 0;
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "usage: %s split [-j threads] [-c chunk] [-o prefix] [-z] n t input\n"
+          "       %s join [-c chunk] -o output share...\n"
+          "  split writes shares prefix.1 - prefix.n (prefix defaults to input)\n"
+          "  -z compresses the input (LZ4) before it is split\n"
+          "  join uses the first t shares given, t being the shares' threshold\n"
+          "  chunk takes K, M and G; -j defaults to one thread per CPU\n",
+          prog, prog);
+}
+
+int main(int argc, char *argv[]) {
+  const char *output = NULL;
+  int opt;
+
+  if (argc < 2) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  const char *command = argv[1];
+
+  /* Options follow the command */
+  optind = 2;
+
+  while ((opt = getopt(argc, argv, "j:c:o:z")) != -1) {
+    switch (opt) {
+      case 'j':
+        thread_count = atol(optarg);
+        break;
+      case 'c':
+        chunk_size = parse_size(optarg);
+        break;
+      case 'o':
+        output = optarg;
+        break;
+      case 'z':
+        split_codec = SHAMIR_CODEC_LZ4;
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
+  if (chunk_size < 1) errx(1, "The chunk size must be at least 1 byte");
+
+  seed_random();
+
+  if (!strcmp(command, "split") && argc - optind == 3) {
+    int n = atoi(argv[optind]);
+    int t = atoi(argv[optind + 1]);
+
+    if (n < 1 || n > 255 || t < 1 || t > n)
+      errx(1, "Need 1 <= t <= n <= 255");
+
+    return split_file(n, t, argv[optind + 2], output ? output : argv[optind + 2]);
+  }
+
+  if (!strcmp(command, "join") && output && argc - optind >= 1)
+    return join_files(argc - optind, argv + optind, output);
+
+  usage(argv[0]);
+  return 1;
+}
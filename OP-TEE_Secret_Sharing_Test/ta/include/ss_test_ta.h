@@ -3,6 +3,8 @@
 #ifndef TA_SS_TEST_H
 #define TA_SS_TEST_H
 
+#include <stdint.h>
+
 // a229078d-9cd2-4959-9cb3-d77cfcf5e862
 // 8ef3283f-a4ab-488a-8b9b-488ca776c4f4
 #define TA_SS_TEST_UUID                              \
@@ -12,52 +14,103 @@
     }                                                \
   }
 
-#define TA_SS_TEST_5 0x1
-#define TA_SS_TEST_10 0x2
-#define TA_SS_TEST_20 0x3
-#define TA_SS_TEST_30 0x4
-#define TA_SS_TEST_40 0x5
-#define TA_SS_TEST_50 0x6
-#define TA_SS_TEST_5_half 7
-#define TA_SS_TEST_10_half 8
-#define TA_SS_TEST_20_half 9
-#define TA_SS_TEST_30_half 10
-#define TA_SS_TEST_40_half 11
-#define TA_SS_TEST_50_half 12
-#define TA_SS_TEST_5_100bytes 13
-#define TA_SS_TEST_10_100bytes 14
-#define TA_SS_TEST_20_100bytes 15
-#define TA_SS_TEST_30_100bytes 16
-#define TA_SS_TEST_40_100bytes 17
-#define TA_SS_TEST_50_100bytes 18
-#define TA_SS_TEST_5_half_100bytes 19
-#define TA_SS_TEST_10_half_100bytes 20
-#define TA_SS_TEST_20_half_100bytes 21
-#define TA_SS_TEST_30_half_100bytes 22
-#define TA_SS_TEST_40_half_100bytes 23
-#define TA_SS_TEST_50_half_100bytes 24
-#define TA_SS_TEST_5_1000bytes 25
-#define TA_SS_TEST_10_1000bytes 26
-#define TA_SS_TEST_20_1000bytes 27
-#define TA_SS_TEST_30_1000bytes 28
-#define TA_SS_TEST_40_1000bytes 29
-#define TA_SS_TEST_50_1000bytes 30
-#define TA_SS_TEST_5_half_1000bytes 31
-#define TA_SS_TEST_10_half_1000bytes 32
-#define TA_SS_TEST_20_half_1000bytes 33
-#define TA_SS_TEST_30_half_1000bytes 34
-#define TA_SS_TEST_40_half_1000bytes 35
-#define TA_SS_TEST_50_half_1000bytes 36
-#define TA_SS_TEST_5_10000bytes 37
-#define TA_SS_TEST_10_10000bytes 38
-#define TA_SS_TEST_20_10000bytes 39
-#define TA_SS_TEST_30_10000bytes 40
-#define TA_SS_TEST_40_10000bytes 41
-#define TA_SS_TEST_50_10000bytes 42
-#define TA_SS_TEST_5_half_10000bytes 43
-#define TA_SS_TEST_10_half_10000bytes 44
-#define TA_SS_TEST_20_half_10000bytes 45
-#define TA_SS_TEST_30_half_10000bytes 46
-#define TA_SS_TEST_40_half_10000bytes 47
-#define TA_SS_TEST_50_half_10000bytes 48
+/* The function IDs implemented in this TA */
+
+/*
+ * TA_SS_TEST_CMD_SPLIT - split a secret of '0's generated inside the TA
+ * param[0] (value) a: number of shares (n, 1..255), b: threshold (t, 1..n)
+ * param[1] (value) a: secret length in bytes
+ * param[2] (value) a: time spent splitting in ms, b: size of the shares
+ *                     in bytes (output)
+ * param[3] unused
+ */
+#define TA_SS_TEST_CMD_SPLIT 0
+
+/*
+ * TA_SS_TEST_CMD_SPLIT_SHM - split a secret supplied by the normal world
+ * param[0] (value) a: number of shares (n, 1..255), b: threshold (t, 1..n)
+ * param[1] (memref) secret bytes
+ * param[2] (memref) receives the shares: n lines of 6 + 2 * size(secret)
+ *                   characters, each ending in '\n' (output)
+ * param[3] (value) a: time spent splitting in ms (output)
+ *
+ * If param[2] is too small, TEE_ERROR_SHORT_BUFFER is returned and its size
+ * is set to the size needed.
+ */
+#define TA_SS_TEST_CMD_SPLIT_SHM 1
+
+/*
+ * TA_SS_TEST_CMD_JOIN_SHM - recreate a secret from shares
+ * param[0] (value) a: number of shares given (k), b: secret length in bytes
+ * param[1] (memref) k share lines in the TA_SS_TEST_CMD_SPLIT_SHM layout
+ * param[2] (memref) receives the secret (output)
+ * param[3] (value) a: time spent joining in ms (output)
+ */
+#define TA_SS_TEST_CMD_JOIN_SHM 2
+
+/*
+ * Chunked split: a secret of any size is split a chunk at a time, so the
+ * TA's secure memory use does not depend on the size of the secret. One job
+ * can be open per session.
+ *
+ * TA_SS_TEST_CMD_SPLIT_OPEN - start a job
+ * param[0] (value) a: number of shares (n, 1..255), b: threshold (t, 1..n)
+ * param[1] (value) a: total secret length in bytes
+ * param[2] (memref) receives the n 6-character share headers (output)
+ * param[3] unused
+ *
+ * TA_SS_TEST_CMD_SPLIT_FEED - split the next chunk of the secret
+ * param[0] (memref) chunk of the secret
+ * param[1] (memref) receives n rows of 2 * size(chunk) characters, row j
+ *                   being the continuation of share j + 1 (output)
+ * param[2] (value) a: bytes consumed so far, b: time spent in ms (output)
+ * param[3] unused
+ *
+ * TA_SS_TEST_CMD_SPLIT_CLOSE - end the job; TEE_ERROR_BAD_STATE if fewer
+ * bytes than announced were fed (the job is dropped either way)
+ */
+#define TA_SS_TEST_CMD_SPLIT_OPEN 3
+#define TA_SS_TEST_CMD_SPLIT_FEED 4
+#define TA_SS_TEST_CMD_SPLIT_CLOSE 5
+
+/* One split job of a TA_SS_TEST_CMD_SPLIT_BATCH */
+struct ss_test_job {
+  uint32_t n;       /* number of shares (1..255) */
+  uint32_t t;       /* threshold (1..n) */
+  uint32_t offset;  /* offset of the secret in the batch's secret buffer */
+  uint32_t len;     /* secret length in bytes */
+  uint32_t ms;      /* time spent on this job over all repeats (output) */
+};
+
+/*
+ * TA_SS_TEST_CMD_SPLIT_BATCH - run many splits in one invocation, so the
+ * cost of entering the TA is paid once for the whole batch
+ * param[0] (memref) array of struct ss_test_job (input/output)
+ * param[1] (memref) secret bytes the jobs point into
+ * param[2] (memref) receives the shares of every job back to back, each in
+ *                   the TA_SS_TEST_CMD_SPLIT_SHM layout (output), or none
+ *                   to drop the shares
+ * param[3] (value) a: times to repeat each job (input), b: time spent on
+ *                     the whole batch in ms (output)
+ *
+ * If param[2] is too small, TEE_ERROR_SHORT_BUFFER is returned and its size
+ * is set to the size needed.
+ */
+#define TA_SS_TEST_CMD_SPLIT_BATCH 6
+
+/*
+ * TA_SS_TEST_CMD_PROFILE - where the previous command on this session spent
+ * its time. Returns TEE_ERROR_NOT_SUPPORTED unless the TA was built with
+ * CFG_DEXO_SSS_PROFILE=y. Times are in microseconds; the heap figures are 0
+ * unless OP-TEE was built with CFG_WITH_STATS=y.
+ * param[0] (value) a: drawing coefficients, b: polynomial evaluation (split)
+ *                     or interpolation and decoding (join) (output)
+ * param[1] (value) a: hex encoding, b: malloc() and free() (output)
+ * param[2] (value) a: heap high-water mark during the command in bytes,
+ *                     b: heap size in bytes (output)
+ * param[3] (value) a: allocations made by libdexo_sss, b: most bytes it had
+ *                     allocated at once (output)
+ */
+#define TA_SS_TEST_CMD_PROFILE 7
+
 #endif /* __PTA_ATTESTATION_H */
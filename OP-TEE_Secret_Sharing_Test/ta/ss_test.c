@@ -27,6 +27,9 @@
 
 #include <ss_test_ta.h>
 #include <stdint.h>
+#ifdef CFG_WITH_STATS
+#include <malloc.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <tee_internal_api.h>
@@ -35,6 +38,42 @@
 
 #include "d_string.h"
 #include "shamir.h"
+
+/* Enough for the library's working set of any split or join (n, t <= 255) */
+#ifndef SS_TEST_ARENA_SIZE
+#define SS_TEST_ARENA_SIZE (8 * 1024)
+#endif
+
+/*
+ * Longest secret a command accepts: the shares of n <= 255 copies of it,
+ * share_strings_size(), must fit in a size_t
+ */
+#define SS_TEST_MAX_LEN ((SIZE_MAX / 255 - 7) / 2)
+
+/*
+ * Compared as a size_t: on 64-bit the bound is above any uint32_t, and
+ * comparing one of those against it directly would always be false
+ */
+static int ss_test_len_ok(size_t len) { return len <= SS_TEST_MAX_LEN; }
+
+/*
+ * Per-session state: the chunked split job opened on this session, if any,
+ * the profile of the last command and the arena the library allocates from
+ */
+struct ss_test_session {
+  struct split_stream *split;
+  uint32_t n;
+  uint32_t total;
+  uint32_t consumed;
+  uint32_t phase_us[SHAMIR_PHASE_COUNT];
+  uint32_t heap_max;
+  uint32_t heap_size;
+  uint32_t lib_allocs;
+  uint32_t lib_peak;
+  struct shamir_arena arena;
+  char arena_buffer[SS_TEST_ARENA_SIZE];
+};
+
 /*
  * Called when the instance of the TA is created. This is the first call in
  * the TA.
@@ -55,14 +94,21 @@ void TA_DestroyEntryPoint(void) {}
  */
 TEE_Result TA_OpenSessionEntryPoint(uint32_t param_types,
                                     TEE_Param __maybe_unused params[4],
-                                    void __maybe_unused **sess_ctx) {
+                                    void **sess_ctx) {
   uint32_t exp_param_types =
       TEE_PARAM_TYPES(TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE,
                       TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE);
   if (param_types != exp_param_types) return TEE_ERROR_BAD_PARAMETERS;
 
   (void)&params;
-  (void)&sess_ctx;
+
+  struct ss_test_session *session =
+      TEE_Malloc(sizeof(*session), TEE_MALLOC_FILL_ZERO);
+  if (!session) return TEE_ERROR_OUT_OF_MEMORY;
+
+  shamir_arena_init(&session->arena, session->arena_buffer,
+                    sizeof(session->arena_buffer));
+  *sess_ctx = session;
 
   return TEE_SUCCESS;
 }
@@ -71,280 +117,450 @@ TEE_Result TA_OpenSessionEntryPoint(uint32_t param_types,
  * Called when a session is closed, sess_ctx hold the value that was
  * assigned by TA_OpenSessionEntryPoint().
  */
-void TA_CloseSessionEntryPoint(void __maybe_unused *sess_ctx) {
-  (void)&sess_ctx;
-}
+void TA_CloseSessionEntryPoint(void *sess_ctx) {
+  struct ss_test_session *session = sess_ctx;
 
-static int prime = 257;
+  split_stream_free(session->split);
+  TEE_Free(session);
+}
 
-int modular_exponentiation(int base, int exp, int mod) {
-  if (exp == 0) {
-    return 1;
-  } else if (exp % 2 == 0) {
-    int mysqrt = modular_exponentiation(base, exp / 2, mod);
-    return (mysqrt * mysqrt) % mod;
-  } else {
-    return (base * modular_exponentiation(base, exp - 1, mod)) % mod;
-  }
+/* Milliseconds elapsed between two TEE_GetSystemTime() readings */
+static uint32_t elapsed_ms(const TEE_Time *start, const TEE_Time *end) {
+  return (end->seconds - start->seconds) * 1000 + end->millis - start->millis;
 }
 
-int *split_number(int number, int n, int t) {
-  int *shares = malloc(sizeof(int) * n);
+static TEE_Result ss_test_split(uint32_t param_types, TEE_Param params[4]) {
+  uint32_t exp_param_types = TEE_PARAM_TYPES(
+      TEE_PARAM_TYPE_VALUE_INPUT, TEE_PARAM_TYPE_VALUE_INPUT,
+      TEE_PARAM_TYPE_VALUE_OUTPUT, TEE_PARAM_TYPE_NONE);
+  TEE_Time start;
+  TEE_Time end;
 
-  int *coef = malloc(sizeof(int) * t);
-  int x;
-  int i;
+  if (param_types != exp_param_types) return TEE_ERROR_BAD_PARAMETERS;
 
-  coef[0] = number;
+  uint32_t n = params[0].value.a;
+  uint32_t t = params[0].value.b;
+  uint32_t l = params[1].value.a;
 
-  for (i = 1; i < t; ++i) {
-    /* Generate random coefficients -- use arc4random if available */
-#ifdef HAVE_ARC4RANDOM
-    coef[i] = arc4random_uniform(prime);
-#else
-    coef[i] = rand() % (prime);
-#endif
+  if (n < 1 || n > 255 || t < 1 || t > n || l < 1 || !ss_test_len_ok(l))
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  char *str = (char *)malloc(l + 1);
+  if (!str) return TEE_ERROR_OUT_OF_MEMORY;
+  memset(str, '0', l);
+  str[l] = '\0';
+
+  TEE_GetSystemTime(&start);
+  char *shares = generate_share_strings(str, n, t);
+  TEE_GetSystemTime(&end);
+
+  if (!shares) {
+    free(str);
+    return TEE_ERROR_OUT_OF_MEMORY;
   }
 
-  for (x = 0; x < n; ++x) {
-    int y = coef[0];
+  params[2].value.a = elapsed_ms(&start, &end);
+  params[2].value.b = share_strings_size(l, n);
 
-    /* Calculate the shares */
-    for (i = 1; i < t; ++i) {
-      int temp = modular_exponentiation(x + 1, i, prime);
+  // use shares. pass
+  shamir_free(shares, share_strings_size(l, n) + 1);
+  free(str);
+  return TEE_SUCCESS;
+}
 
-      y = (y + (coef[i] * temp % prime)) % prime;
-    }
+static TEE_Result ss_test_split_shm(uint32_t param_types,
+                                    TEE_Param params[4]) {
+  uint32_t exp_param_types = TEE_PARAM_TYPES(
+      TEE_PARAM_TYPE_VALUE_INPUT, TEE_PARAM_TYPE_MEMREF_INPUT,
+      TEE_PARAM_TYPE_MEMREF_OUTPUT, TEE_PARAM_TYPE_VALUE_OUTPUT);
+  TEE_Time start;
+  TEE_Time end;
 
-    /* Sometimes we're getting negative numbers, and need to fix that */
-    y = (y + prime) % prime;
+  if (param_types != exp_param_types) return TEE_ERROR_BAD_PARAMETERS;
 
-    shares[x] = y;
+  uint32_t n = params[0].value.a;
+  uint32_t t = params[0].value.b;
+  const char *secret = params[1].memref.buffer;
+  size_t len = params[1].memref.size;
+
+  if (n < 1 || n > 255 || t < 1 || t > n || !ss_test_len_ok(len))
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  size_t needed = share_strings_size(len, n);
+  if (params[2].memref.size < needed) {
+    params[2].memref.size = needed;
+    return TEE_ERROR_SHORT_BUFFER;
   }
 
-  free(coef);
+  /* The shares are written straight into the normal world's buffer */
+  TEE_GetSystemTime(&start);
+  int ok = write_share_strings(secret, len, n, t, params[2].memref.buffer);
+  TEE_GetSystemTime(&end);
+
+  if (!ok) return TEE_ERROR_OUT_OF_MEMORY;
 
-  return shares;
+  params[2].memref.size = needed;
+  params[3].value.a = elapsed_ms(&start, &end);
+  return TEE_SUCCESS;
 }
 
-char **split_string(char *secret, int n, int t) {
-  int len = strlen(secret);
+static TEE_Result ss_test_join_shm(uint32_t param_types, TEE_Param params[4]) {
+  uint32_t exp_param_types = TEE_PARAM_TYPES(
+      TEE_PARAM_TYPE_VALUE_INPUT, TEE_PARAM_TYPE_MEMREF_INPUT,
+      TEE_PARAM_TYPE_MEMREF_OUTPUT, TEE_PARAM_TYPE_VALUE_OUTPUT);
+  TEE_Time start;
+  TEE_Time end;
 
-  char **shares = malloc(sizeof(char *) * n);
-  int i;
+  if (param_types != exp_param_types) return TEE_ERROR_BAD_PARAMETERS;
 
-  for (i = 0; i < n; ++i) {
-    /* need two characters to encode each character */
-    /* Need 4 character overhead for share # and quorum # */
-    /* Additional 2 characters are for compatibility with:
+  uint32_t k = params[0].value.a;
+  size_t len = params[0].value.b;
+  char *rows = params[1].memref.buffer;
 
-            http://www.christophedavid.org/w/c/w.php/Calculators/ShamirSecretSharing
-    */
-    shares[i] = (char *)malloc(2 * len + 6 + 1);
+  /* Bounding len first keeps k * stride from wrapping */
+  if (k < 1 || k > 255 || !ss_test_len_ok(len))
+    return TEE_ERROR_BAD_PARAMETERS;
 
-    sprintf(shares[i], "%02X%02XAA", (i + 1), t);
-  }
+  size_t stride = 6 + 2 * len + 1;
 
-  /* Now, handle the secret */
+  /* The last line's '\n' is optional */
+  if (params[1].memref.size < k * stride - 1) return TEE_ERROR_BAD_PARAMETERS;
 
-  for (i = 0; i < len; ++i) {
-    int letter = secret[i];  // - '0';
+  if (params[2].memref.size < len) {
+    params[2].memref.size = len;
+    return TEE_ERROR_SHORT_BUFFER;
+  }
 
-    if (letter < 0) {
-      letter = 256 + letter;
-    }
+  char **shares = malloc(sizeof(char *) * k);
+  if (!shares) return TEE_ERROR_OUT_OF_MEMORY;
 
-    int *chunks = split_number(letter, n, t);
-    int j;
+  /* Point at the share lines in place rather than copying them */
+  for (uint32_t i = 0; i < k; i++) shares[i] = rows + i * stride;
 
-    for (j = 0; j < n; ++j) {
-      if (chunks[j] == 256) {
-        sprintf(shares[j] + 6 + i * 2, "G0"); /* Fake code */
-      } else {
-        sprintf(shares[j] + 6 + i * 2, "%02X", chunks[j]);
-      }
-    }
+  TEE_GetSystemTime(&start);
+  int ok = join_strings_range_into(shares, k, 0, len, params[2].memref.buffer);
+  TEE_GetSystemTime(&end);
+  free(shares);
 
-    free(chunks);
-  }
+  if (!ok) return TEE_ERROR_BAD_PARAMETERS;
 
-  return shares;
+  params[2].memref.size = len;
+  params[3].value.a = elapsed_ms(&start, &end);
+  return TEE_SUCCESS;
 }
 
-void free_string_shares(char **shares, int n) {
-  int i;
+static TEE_Result ss_test_split_open(struct ss_test_session *session,
+                                     uint32_t param_types,
+                                     TEE_Param params[4]) {
+  uint32_t exp_param_types = TEE_PARAM_TYPES(
+      TEE_PARAM_TYPE_VALUE_INPUT, TEE_PARAM_TYPE_VALUE_INPUT,
+      TEE_PARAM_TYPE_MEMREF_OUTPUT, TEE_PARAM_TYPE_NONE);
+
+  if (param_types != exp_param_types) return TEE_ERROR_BAD_PARAMETERS;
+  if (session->split) return TEE_ERROR_BAD_STATE;
+
+  uint32_t n = params[0].value.a;
+  uint32_t t = params[0].value.b;
 
-  for (i = 0; i < n; ++i) {
-    free(shares[i]);
+  /* Every chunk is at most the total, so this also bounds row * n in FEED */
+  if (n < 1 || n > 255 || t < 1 || t > n ||
+      !ss_test_len_ok(params[1].value.a))
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  if (params[2].memref.size < 6 * n) {
+    params[2].memref.size = 6 * n;
+    return TEE_ERROR_SHORT_BUFFER;
   }
 
-  free(shares);
+  session->split = split_stream_new(n, t);
+  if (!session->split) return TEE_ERROR_OUT_OF_MEMORY;
+
+  session->n = n;
+  session->total = params[1].value.a;
+  session->consumed = 0;
+
+  char *headers = params[2].memref.buffer;
+  for (uint32_t i = 0; i < n; i++)
+    split_stream_header(session->split, i + 1, headers + 6 * i);
+
+  params[2].memref.size = 6 * n;
+  return TEE_SUCCESS;
 }
 
-char *generate_share_strings(char *secret, int n, int t) {
-  char **result = split_string(secret, n, t);
+static TEE_Result ss_test_split_feed(struct ss_test_session *session,
+                                     uint32_t param_types,
+                                     TEE_Param params[4]) {
+  uint32_t exp_param_types = TEE_PARAM_TYPES(
+      TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_MEMREF_OUTPUT,
+      TEE_PARAM_TYPE_VALUE_OUTPUT, TEE_PARAM_TYPE_NONE);
+  TEE_Time start;
+  TEE_Time end;
 
-  int len = strlen(secret);
-  int key_len = 6 + 2 * len + 1;
-  int i;
+  if (param_types != exp_param_types) return TEE_ERROR_BAD_PARAMETERS;
+  if (!session->split) return TEE_ERROR_BAD_STATE;
 
-  char *shares = malloc(key_len * n + 1);
+  size_t len = params[0].memref.size;
+  size_t row = 2 * len;
 
-  for (i = 0; i < n; ++i) {
-    sprintf(shares + i * key_len, "%s\n", result[i]);
+  if (len > session->total - session->consumed)
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  if (params[1].memref.size < row * session->n) {
+    params[1].memref.size = row * session->n;
+    return TEE_ERROR_SHORT_BUFFER;
   }
 
-  free_string_shares(result, n);
+  TEE_GetSystemTime(&start);
+  split_stream_feed(session->split, params[0].memref.buffer, len,
+                    params[1].memref.buffer, row);
+  TEE_GetSystemTime(&end);
+
+  session->consumed += len;
 
-  return shares;
+  params[1].memref.size = row * session->n;
+  params[2].value.a = session->consumed;
+  params[2].value.b = elapsed_ms(&start, &end);
+  return TEE_SUCCESS;
 }
 
-static TEE_Result ss_test(uint32_t param_types, TEE_Param params[4], int n,
-                          int l) {
+static TEE_Result ss_test_split_close(struct ss_test_session *session,
+                                      uint32_t param_types) {
   uint32_t exp_param_types =
       TEE_PARAM_TYPES(TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE,
                       TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE);
 
   if (param_types != exp_param_types) return TEE_ERROR_BAD_PARAMETERS;
-  int t = (n * 2 + 2) / 3;
-  char *str = (char *)malloc(l + 1);
-  memset(str, '0', l);
-  str[l] = '\0';
-  char *shares = generate_share_strings(str, n, t);
-  // use shares. pass
-  free(shares);
-  free(str);
-  return TEE_SUCCESS;
+  if (!session->split) return TEE_ERROR_BAD_STATE;
+
+  int complete = session->consumed == session->total;
+
+  split_stream_free(session->split);
+  session->split = NULL;
+
+  return complete ? TEE_SUCCESS : TEE_ERROR_BAD_STATE;
 }
 
-static TEE_Result ss_test_half(uint32_t param_types, TEE_Param params[4], int n,
-                               int l) {
-  uint32_t exp_param_types =
-      TEE_PARAM_TYPES(TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE,
-                      TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE);
+static TEE_Result ss_test_split_batch(uint32_t param_types,
+                                      TEE_Param params[4]) {
+  uint32_t exp_param_types = TEE_PARAM_TYPES(
+      TEE_PARAM_TYPE_MEMREF_INOUT, TEE_PARAM_TYPE_MEMREF_INPUT,
+      TEE_PARAM_TYPE_GET(param_types, 2), TEE_PARAM_TYPE_VALUE_INOUT);
+  uint32_t shares_type = TEE_PARAM_TYPE_GET(param_types, 2);
+  TEE_Time batch_start;
+  TEE_Time start;
+  TEE_Time end;
 
   if (param_types != exp_param_types) return TEE_ERROR_BAD_PARAMETERS;
-  int t = (n + 1) / 2;
+  if (shares_type != TEE_PARAM_TYPE_MEMREF_OUTPUT &&
+      shares_type != TEE_PARAM_TYPE_NONE)
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  struct ss_test_job *shared_jobs = params[0].memref.buffer;
+  size_t count = params[0].memref.size / sizeof(*shared_jobs);
+  const char *secrets = params[1].memref.buffer;
+  size_t secrets_size = params[1].memref.size;
+  uint32_t repeat = params[3].value.a ? params[3].value.a : 1;
+  size_t needed = 0;
+  size_t largest = 0;
+
+  /*
+   * The normal world can rewrite shared memory at any time, so the jobs are
+   * checked and run from a private copy
+   */
+  struct ss_test_job *jobs = TEE_Malloc(count ? count * sizeof(*jobs) : 1, 0);
+  if (!jobs) return TEE_ERROR_OUT_OF_MEMORY;
+  TEE_MemMove(jobs, shared_jobs, count * sizeof(*jobs));
+
+  /* Check every job before running any of them */
+  for (size_t i = 0; i < count; i++) {
+    uint32_t n = jobs[i].n;
+    uint32_t t = jobs[i].t;
+
+    if (n < 1 || n > 255 || t < 1 || t > n || !ss_test_len_ok(jobs[i].len) ||
+        jobs[i].offset > secrets_size ||
+        jobs[i].len > secrets_size - jobs[i].offset) {
+      TEE_Free(jobs);
+      return TEE_ERROR_BAD_PARAMETERS;
+    }
 
-  char *str = (char *)malloc(l + 1);
-  memset(str, '0', l);
-  str[l] = '\0';
+    size_t size = share_strings_size(jobs[i].len, n);
+    if (size > SIZE_MAX - needed) {
+      TEE_Free(jobs);
+      return TEE_ERROR_BAD_PARAMETERS;
+    }
 
-  char *shares = generate_share_strings(str, n, t);
-  // use shares. pass
-  free(shares);
-  free(str);
+    needed += size;
+    if (size > largest) largest = size;
+  }
+
+  char *out = NULL;
+  char *scratch = NULL;
+
+  if (shares_type == TEE_PARAM_TYPE_MEMREF_OUTPUT) {
+    if (params[2].memref.size < needed) {
+      TEE_Free(jobs);
+      params[2].memref.size = needed;
+      return TEE_ERROR_SHORT_BUFFER;
+    }
+    out = params[2].memref.buffer;
+    params[2].memref.size = needed;
+  } else {
+    /* The shares are dropped, so every job can reuse one buffer */
+    scratch = malloc(largest ? largest : 1);
+    if (!scratch) {
+      TEE_Free(jobs);
+      return TEE_ERROR_OUT_OF_MEMORY;
+    }
+  }
+
+  TEE_GetSystemTime(&batch_start);
+  for (size_t i = 0; i < count; i++) {
+    char *dest = out ? out : scratch;
+    int ok = 1;
+
+    TEE_GetSystemTime(&start);
+    for (uint32_t r = 0; r < repeat && ok; r++)
+      ok = write_share_strings(secrets + jobs[i].offset, jobs[i].len,
+                               jobs[i].n, jobs[i].t, dest);
+    TEE_GetSystemTime(&end);
+
+    if (!ok) {
+      free(scratch);
+      TEE_Free(jobs);
+      return TEE_ERROR_OUT_OF_MEMORY;
+    }
+
+    jobs[i].ms = elapsed_ms(&start, &end);
+    if (out) out += share_strings_size(jobs[i].len, jobs[i].n);
+  }
+  TEE_GetSystemTime(&end);
+  params[3].value.b = elapsed_ms(&batch_start, &end);
+
+  /* Only the times go back to the normal world's array */
+  for (size_t i = 0; i < count; i++) shared_jobs[i].ms = jobs[i].ms;
+
+  free(scratch);
+  TEE_Free(jobs);
   return TEE_SUCCESS;
 }
 
+static TEE_Result ss_test_profile(struct ss_test_session *session,
+                                  uint32_t param_types, TEE_Param params[4]) {
+  uint32_t exp_param_types = TEE_PARAM_TYPES(
+      TEE_PARAM_TYPE_VALUE_OUTPUT, TEE_PARAM_TYPE_VALUE_OUTPUT,
+      TEE_PARAM_TYPE_VALUE_OUTPUT, TEE_PARAM_TYPE_VALUE_OUTPUT);
+
+  if (param_types != exp_param_types) return TEE_ERROR_BAD_PARAMETERS;
+
+#ifdef SHAMIR_PROFILE
+  params[0].value.a = session->phase_us[SHAMIR_PHASE_RANDOM];
+  params[0].value.b = session->phase_us[SHAMIR_PHASE_EVALUATE];
+  params[1].value.a = session->phase_us[SHAMIR_PHASE_ENCODE];
+  params[1].value.b = session->phase_us[SHAMIR_PHASE_ALLOC];
+  params[2].value.a = session->heap_max;
+  params[2].value.b = session->heap_size;
+  params[3].value.a = session->lib_allocs;
+  params[3].value.b = session->lib_peak;
+  return TEE_SUCCESS;
+#else
+  (void)session;
+  (void)params;
+  return TEE_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+/* Start profiling a command */
+static void profile_begin(void) {
+  shamir_profile_reset();
+#ifdef SHAMIR_PROFILE
+  shamir_alloc_stats_reset();
+#endif
+#ifdef CFG_WITH_STATS
+  malloc_reset_stats();
+#endif
+}
+
+/* Keep the profile of the command that just ran for TA_SS_TEST_CMD_PROFILE */
+static void profile_end(struct ss_test_session *session) {
+  for (int i = 0; i < SHAMIR_PHASE_COUNT; i++)
+    session->phase_us[i] = shamir_profile_us(i);
+
+#ifdef SHAMIR_PROFILE
+  struct shamir_alloc_stats allocs;
+
+  shamir_alloc_stats_get(&allocs);
+  session->lib_allocs = allocs.allocs;
+  session->lib_peak = allocs.peak_bytes;
+#endif
+
+#ifdef CFG_WITH_STATS
+  struct malloc_stats stats;
+
+  malloc_get_stats(&stats);
+  session->heap_max = stats.max_allocated;
+  session->heap_size = stats.size;
+#endif
+}
+
+static TEE_Result ss_test_invoke(struct ss_test_session *session,
+                                 uint32_t cmd_id, uint32_t param_types,
+                                 TEE_Param params[4]) {
+  switch (cmd_id) {
+    case TA_SS_TEST_CMD_SPLIT:
+      return ss_test_split(param_types, params);
+    case TA_SS_TEST_CMD_SPLIT_SHM:
+      return ss_test_split_shm(param_types, params);
+    case TA_SS_TEST_CMD_JOIN_SHM:
+      return ss_test_join_shm(param_types, params);
+    case TA_SS_TEST_CMD_SPLIT_OPEN:
+      return ss_test_split_open(session, param_types, params);
+    case TA_SS_TEST_CMD_SPLIT_FEED:
+      return ss_test_split_feed(session, param_types, params);
+    case TA_SS_TEST_CMD_SPLIT_CLOSE:
+      return ss_test_split_close(session, param_types);
+    case TA_SS_TEST_CMD_SPLIT_BATCH:
+      return ss_test_split_batch(param_types, params);
+    default:
+      return TEE_ERROR_BAD_PARAMETERS;
+  }
+}
+
+/*
+ * Commands that are done with everything the library allocated by the time
+ * they return run it on the session's arena, so the split and join loops make
+ * no heap calls. The chunked split keeps its stream from one command to the
+ * next and stays on the heap.
+ */
+static int runs_on_arena(uint32_t cmd_id) {
+  switch (cmd_id) {
+    case TA_SS_TEST_CMD_SPLIT:
+    case TA_SS_TEST_CMD_SPLIT_SHM:
+    case TA_SS_TEST_CMD_JOIN_SHM:
+    case TA_SS_TEST_CMD_SPLIT_BATCH:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
 /*
  * Called when a TA is invoked. sess_ctx hold that value that was
  * assigned by TA_OpenSessionEntryPoint(). The rest of the paramters
  * comes from normal world.
  */
-TEE_Result TA_InvokeCommandEntryPoint(void __maybe_unused *sess_ctx,
-                                      uint32_t cmd_id, uint32_t param_types,
+TEE_Result TA_InvokeCommandEntryPoint(void *sess_ctx, uint32_t cmd_id,
+                                      uint32_t param_types,
                                       TEE_Param params[4]) {
-  (void)&sess_ctx; /* Unused parameter */
+  struct ss_test_session *session = sess_ctx;
 
-  switch (cmd_id) {
-    case TA_SS_TEST_5:
-      return ss_test(param_types, params, 5, 1000);
-    case TA_SS_TEST_10:
-      return ss_test(param_types, params, 10, 1000);
-    case TA_SS_TEST_20:
-      return ss_test(param_types, params, 20, 1000);
-    case TA_SS_TEST_30:
-      return ss_test(param_types, params, 30, 1000);
-    case TA_SS_TEST_40:
-      return ss_test(param_types, params, 40, 1000);
-    case TA_SS_TEST_50:
-      return ss_test(param_types, params, 50, 1000);
-    case TA_SS_TEST_5_half:
-      return ss_test_half(param_types, params, 5, 1000);
-    case TA_SS_TEST_10_half:
-      return ss_test_half(param_types, params, 10, 1000);
-    case TA_SS_TEST_20_half:
-      return ss_test_half(param_types, params, 20, 1000);
-    case TA_SS_TEST_30_half:
-      return ss_test_half(param_types, params, 30, 1000);
-    case TA_SS_TEST_40_half:
-      return ss_test_half(param_types, params, 40, 1000);
-    case TA_SS_TEST_50_half:
-      return ss_test_half(param_types, params, 50, 1000);
-    case TA_SS_TEST_5_100bytes:
-      return ss_test(param_types, params, 5, 100);
-    case TA_SS_TEST_10_100bytes:
-      return ss_test(param_types, params, 10, 100);
-    case TA_SS_TEST_20_100bytes:
-      return ss_test(param_types, params, 20, 100);
-    case TA_SS_TEST_30_100bytes:
-      return ss_test(param_types, params, 30, 100);
-    case TA_SS_TEST_40_100bytes:
-      return ss_test(param_types, params, 40, 100);
-    case TA_SS_TEST_50_100bytes:
-      return ss_test(param_types, params, 50, 100);
-    case TA_SS_TEST_5_half_100bytes:
-      return ss_test_half(param_types, params, 5, 100);
-    case TA_SS_TEST_10_half_100bytes:
-      return ss_test_half(param_types, params, 10, 100);
-    case TA_SS_TEST_20_half_100bytes:
-      return ss_test_half(param_types, params, 20, 100);
-    case TA_SS_TEST_30_half_100bytes:
-      return ss_test_half(param_types, params, 30, 100);
-    case TA_SS_TEST_40_half_100bytes:
-      return ss_test_half(param_types, params, 40, 100);
-    case TA_SS_TEST_50_half_100bytes:
-      return ss_test_half(param_types, params, 50, 100);
-    case TA_SS_TEST_5_1000bytes:
-      return ss_test(param_types, params, 5, 1000);
-    case TA_SS_TEST_10_1000bytes:
-      return ss_test(param_types, params, 10, 1000);
-    case TA_SS_TEST_20_1000bytes:
-      return ss_test(param_types, params, 20, 1000);
-    case TA_SS_TEST_30_1000bytes:
-      return ss_test(param_types, params, 30, 1000);
-    case TA_SS_TEST_40_1000bytes:
-      return ss_test(param_types, params, 40, 1000);
-    case TA_SS_TEST_50_1000bytes:
-      return ss_test(param_types, params, 50, 1000);
-    case TA_SS_TEST_5_half_1000bytes:
-      return ss_test_half(param_types, params, 5, 1000);
-    case TA_SS_TEST_10_half_1000bytes:
-      return ss_test_half(param_types, params, 10, 1000);
-    case TA_SS_TEST_20_half_1000bytes:
-      return ss_test_half(param_types, params, 20, 1000);
-    case TA_SS_TEST_30_half_1000bytes:
-      return ss_test_half(param_types, params, 30, 1000);
-    case TA_SS_TEST_40_half_1000bytes:
-      return ss_test_half(param_types, params, 40, 1000);
-    case TA_SS_TEST_50_half_1000bytes:
-      return ss_test_half(param_types, params, 50, 1000);
-    case TA_SS_TEST_5_10000bytes:
-      return ss_test(param_types, params, 5, 10000);
-    case TA_SS_TEST_10_10000bytes:
-      return ss_test(param_types, params, 10, 10000);
-    case TA_SS_TEST_20_10000bytes:
-      return ss_test(param_types, params, 20, 10000);
-    case TA_SS_TEST_30_10000bytes:
-      return ss_test(param_types, params, 30, 10000);
-    case TA_SS_TEST_40_10000bytes:
-      return ss_test(param_types, params, 40, 10000);
-    case TA_SS_TEST_50_10000bytes:
-      return ss_test(param_types, params, 50, 10000);
-    case TA_SS_TEST_5_half_10000bytes:
-      return ss_test_half(param_types, params, 5, 10000);
-    case TA_SS_TEST_10_half_10000bytes:
-      return ss_test_half(param_types, params, 10, 10000);
-    case TA_SS_TEST_20_half_10000bytes:
-      return ss_test_half(param_types, params, 20, 10000);
-    case TA_SS_TEST_30_half_10000bytes:
-      return ss_test_half(param_types, params, 30, 10000);
-    case TA_SS_TEST_40_half_10000bytes:
-      return ss_test_half(param_types, params, 40, 10000);
-    case TA_SS_TEST_50_half_10000bytes:
-      return ss_test_half(param_types, params, 50, 10000);
-    default:
-      return TEE_ERROR_BAD_PARAMETERS;
-  }
+  if (cmd_id == TA_SS_TEST_CMD_PROFILE)
+    return ss_test_profile(session, param_types, params);
+
+  profile_begin();
+  if (runs_on_arena(cmd_id)) shamir_use_arena(&session->arena);
+  TEE_Result res = ss_test_invoke(session, cmd_id, param_types, params);
+  shamir_use_arena(NULL);
+  profile_end(session);
+
+  return res;
 }
@@ -1,5 +1,11 @@
 global-incdirs-y += include
+global-incdirs-y += ../libdexo_sss/include
 srcs-y += ss_test.c
 
+# Must match the libdexo_sss build, for TA_SS_TEST_CMD_PROFILE
+ifeq ($(CFG_DEXO_SSS_PROFILE),y)
+cflags-y += -DSHAMIR_PROFILE
+endif
+
 # To remove a certain compiler flag, add a line like this
 #cflags-template_ta.c-y += -Wno-strict-prototypes
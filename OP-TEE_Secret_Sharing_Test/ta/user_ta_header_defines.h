@@ -43,8 +43,12 @@
  */
 #define TA_FLAGS TA_FLAG_EXEC_DDR
 
-/* Provisioned stack size */
-#define TA_STACK_SIZE (2 * 1024)
+/*
+ * Provisioned stack size: TA_SS_TEST_CMD_JOIN_SHM joins from up to 255
+ * shares, with the x values, their sorted copy and the interpolation
+ * accumulators (about 1.5 KB) on the stack
+ */
+#define TA_STACK_SIZE (4 * 1024)
 
 /* Provisioned heap size for TEE_Malloc() and friends */
 #define TA_DATA_SIZE (32 * 1024)